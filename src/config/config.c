@@ -34,7 +34,10 @@
 #include "config.h"
 #include "live/channelcache.h"
 #include "live/livequeue.h"
+#include "live/livereceiver.h"
 #include "recordings/recordingscache.h"
+#include "xvdr/xvdrworker.h"
+#include "xvdr/xvdrwriter.h"
 
 cXVDRServerConfig::cXVDRServerConfig()
 {
@@ -42,6 +45,7 @@ cXVDRServerConfig::cXVDRServerConfig()
   ConfigDirectory     = NULL;
   stream_timeout      = 3;
   ReorderCmd          = NULL;
+  CompressionThreshold = 512;
 }
 
 void cXVDRServerConfig::Load() {
@@ -69,6 +73,14 @@ bool cXVDRServerConfig::Parse(const char* Name, const char* Value)
 {
   if     (!strcasecmp(Name, "TimeShiftDir")) cLiveQueue::SetTimeShiftDir(Value);
   else if(!strcasecmp(Name, "MaxTimeShiftSize")) cLiveQueue::SetBufferSize(strtoull(Value, NULL, 10));
+  else if(!strcasecmp(Name, "TimeShiftMemory")) cLiveQueue::SetMemorySize(strtoull(Value, NULL, 10));
+  else if(!strcasecmp(Name, "MaxBatchPackets")) cXVDRWriter::SetMaxBatchPackets(atoi(Value));
+  else if(!strcasecmp(Name, "BatchLatency")) cXVDRWriter::SetBatchLatency(atoi(Value));
+  else if(!strcasecmp(Name, "MaxQueueSize")) cLiveQueue::SetMaxQueueSize(strtoul(Value, NULL, 10));
+  else if(!strcasecmp(Name, "MaxQueueLatency")) cLiveQueue::SetMaxQueueLatency(atoi(Value));
+  else if(!strcasecmp(Name, "GOPCacheSize")) cLiveReceiver::SetGOPCacheSize(strtoul(Value, NULL, 10));
+  else if(!strcasecmp(Name, "WorkerThreads")) cXVDRWorkerPool::SetThreadCount(atoi(Value));
+  else if(!strcasecmp(Name, "CompressionThreshold")) CompressionThreshold = strtoul(Value, NULL, 10);
   else if(!strcasecmp(Name, "PiconsURL")) PiconsURL = Value;
   else if(!strcasecmp(Name, "ReorderCmd")) ReorderCmd = Value;
   else return false;
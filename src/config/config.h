@@ -88,6 +88,7 @@ public:
   uint16_t stream_timeout;      // timeout in seconds for stream data
   cString PiconsURL;
   cString ReorderCmd;
+  uint32_t CompressionThreshold; // minimum payload size for compressed responses
 };
 
 // Global instance
@@ -26,7 +26,7 @@
 #include <vdr/remux.h>
 
 #include "config/config.h"
-#include "live/livestreamer.h"
+#include "live/livereceiver.h"
 #include "demuxer.h"
 #include "parser.h"
 #include "pes.h"
@@ -41,12 +41,12 @@
 
 #define DVD_TIME_BASE 1000000
 
-cTSDemuxer::cTSDemuxer(cLiveStreamer *streamer, const cStreamInfo& info) : cStreamInfo(info), m_Streamer(streamer) {
+cTSDemuxer::cTSDemuxer(cLiveReceiver *receiver, const cStreamInfo& info) : cStreamInfo(info), m_Receiver(receiver) {
   m_pesParser = CreateParser(m_type);
   SetContent();
 }
 
-cTSDemuxer::cTSDemuxer(cLiveStreamer *streamer, cStreamInfo::Type type, int pid) : cStreamInfo(pid, type), m_Streamer(streamer) {
+cTSDemuxer::cTSDemuxer(cLiveReceiver *receiver, cStreamInfo::Type type, int pid) : cStreamInfo(pid, type), m_Receiver(receiver) {
   m_pesParser = CreateParser(m_type);
 }
 
@@ -111,7 +111,7 @@ void cTSDemuxer::SendPacket(sStreamPacket *pkt)
   pkt->pts      = pts;
   pkt->duration = Rescale(pkt->duration);
 
-  m_Streamer->sendStreamPacket(pkt);
+  m_Receiver->sendStreamPacket(pkt);
 }
 
 bool cTSDemuxer::ProcessTSPacket(unsigned char *data)
@@ -201,7 +201,7 @@ void cTSDemuxer::SetVideoInformation(int FpsScale, int FpsRate, int Height, int
   m_aspect   = Aspect;
   m_parsed   = true;
 
-  m_Streamer->RequestStreamChange();
+  m_Receiver->RequestStreamChange();
 }
 
 void cTSDemuxer::SetAudioInformation(int Channels, int SampleRate, int BitRate, int BitsPerSample, int BlockAlign)
@@ -225,6 +225,6 @@ void cTSDemuxer::SetAudioInformation(int Channels, int SampleRate, int BitRate,
   m_bitspersample = BitsPerSample;
   m_parsed        = true;
 
-  m_Streamer->RequestStreamChange();
+  m_Receiver->RequestStreamChange();
 }
 
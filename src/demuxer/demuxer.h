@@ -29,7 +29,7 @@
 #include <stdint.h>
 #include "streaminfo.h"
 
-class cLiveStreamer;
+class cLiveReceiver;
 class cParser;
 
 #define DVD_NOPTS_VALUE    (-1LL<<52) // should be possible to represent in both double and __int64
@@ -59,14 +59,14 @@ class cTSDemuxer : public cStreamInfo
 {
 private:
 
-  cLiveStreamer* m_Streamer;
+  cLiveReceiver* m_Receiver;
   cParser* m_pesParser;
 
   int64_t Rescale(int64_t a);
 
 public:
-  cTSDemuxer(cLiveStreamer *streamer, cStreamInfo::Type type, int pid);
-  cTSDemuxer(cLiveStreamer *streamer, const cStreamInfo& info);
+  cTSDemuxer(cLiveReceiver *receiver, cStreamInfo::Type type, int pid);
+  cTSDemuxer(cLiveReceiver *receiver, const cStreamInfo& info);
   virtual ~cTSDemuxer();
 
   bool ProcessTSPacket(unsigned char *data);
@@ -41,7 +41,8 @@ public:
     scAUDIO,
     scSUBTITLE,
     scTELETEXT,
-    scSTREAMINFO
+    scSTREAMINFO,
+    scRAWTS         // raw transport stream chunk (all streams)
   };
 
   enum Type
@@ -26,7 +26,7 @@
 #include "xvdr/xvdrchannels.h"
 #include "tools/hash.h"
 #include "channelcache.h"
-#include "livestreamer.h"
+#include "livereceiver.h"
 
 cMutex cChannelCache::m_access;
 std::map<uint32_t, cChannelCache> cChannelCache::m_cache;
@@ -65,22 +65,30 @@ bool cChannelCache::IsParsed() {
 }
 
 
-void cChannelCache::CreateDemuxers(cLiveStreamer* streamer) {
+void cChannelCache::CreateDemuxers(cLiveReceiver* receiver) {
   cChannelCache old;
 
   // remove old demuxers
-  for (std::list<cTSDemuxer*>::iterator i = streamer->m_Demuxers.begin(); i != streamer->m_Demuxers.end(); i++) {
+  for (std::list<cTSDemuxer*>::iterator i = receiver->m_Demuxers.begin(); i != receiver->m_Demuxers.end(); i++) {
     old.AddStream(*(*i));
     delete *i;
   }
 
-  streamer->m_Demuxers.clear();
-  streamer->SetPids(NULL);
+  receiver->m_Demuxers.clear();
+  receiver->SetPids(NULL);
 
   // create new stream demuxers
   for (iterator i = begin(); i != end(); i++)
   {
     cStreamInfo& infonew = i->second;
+
+    // no client subscribed to this stream (still received, so the
+    // demuxer can be added without detaching the receiver)
+    if(!receiver->IsSelected(infonew)) {
+      receiver->AddPid(infonew.GetPID());
+      continue;
+    }
+
     cStreamInfo& infoold = old[i->first];
 
     // reuse previous stream information
@@ -88,14 +96,17 @@ void cChannelCache::CreateDemuxers(cLiveStreamer* streamer) {
       infonew = infoold;
     }
 
-    cTSDemuxer* dmx = new cTSDemuxer(streamer, infonew);
+    cTSDemuxer* dmx = new cTSDemuxer(receiver, infonew);
     if (dmx != NULL)
     {
       dmx->info();
-      streamer->m_Demuxers.push_back(dmx);
-      streamer->AddPid(infonew.GetPID());
+      receiver->m_Demuxers.push_back(dmx);
+      receiver->AddPid(infonew.GetPID());
     }
   }
+
+  receiver->UpdatePidTable();
+  receiver->clearCache();
 }
 
 bool cChannelCache::operator ==(const cChannelCache& c) const {
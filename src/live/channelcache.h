@@ -35,7 +35,7 @@
 #include <fstream>
 #include <string.h>
 
-class cLiveStreamer;
+class cLiveReceiver;
 
 class cChannelCache : public std::map<int, cStreamInfo> {
 public:
@@ -44,7 +44,7 @@ public:
 
   void AddStream(const cStreamInfo& s);
 
-  void CreateDemuxers(cLiveStreamer* streamer);
+  void CreateDemuxers(cLiveReceiver* receiver);
 
   bool operator ==(const cChannelCache& c) const;
 
@@ -31,7 +31,7 @@
 #include "xvdr/xvdrchannels.h"
 
 #include "livepatfilter.h"
-#include "livestreamer.h"
+#include "livereceiver.h"
 
 static const char * const psStreamTypes[] = {
         "UNKNOWN",
@@ -57,11 +57,11 @@ static const char * const psStreamTypes[] = {
         "",
 };
 
-cLivePatFilter::cLivePatFilter(cLiveStreamer *Streamer)
+cLivePatFilter::cLivePatFilter(cLiveReceiver *Receiver)
 {
   DEBUGLOG("cStreamdevPatFilter(\"%s\")", Channel->Name());
   m_Channel     = NULL;
-  m_Streamer    = Streamer;
+  m_Receiver    = Receiver;
   m_pmtPid      = 0;
   m_pmtSid      = 0;
   m_pmtVersion  = -1;
@@ -370,29 +370,34 @@ void cLivePatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Le
       }
     }
 
-    // no new streams found -> exit
-    if (m_ChannelCache.ismetaof(cache))
+    // no new streams found -> the cached streams may be used right away
+    if (m_ChannelCache.ismetaof(cache)) {
+      m_Receiver->ConfirmStreams();
       return;
+    }
+
+    m_Receiver->m_FilterMutex.Lock();
 
-    m_Streamer->m_FilterMutex.Lock();
+    // the cached streams don't apply anymore
+    m_Receiver->m_warmPending = false;
 
     // do not restart the receiver (detach / attach) for VDR >= 2.1.6
     // VDR's ChannelChange notification will trigger the detach / attach procedure
     // and also recreate the demuxers
 
 #if VDRVERSNUM < 20106 // VDR VERSION < 2.1.6
-    if(m_Streamer->IsAttached()) {
-      m_Streamer->Detach();
+    if(m_Receiver->IsAttached()) {
+      m_Receiver->Detach();
     }
 
     // create new stream demuxers
-    cache.CreateDemuxers(m_Streamer);
+    cache.CreateDemuxers(m_Receiver);
 #endif
 
-    m_Streamer->m_ready = false;
+    m_Receiver->m_ready = false;
     INFOLOG("Currently unknown new streams found, requesting stream change");
 
-    m_Streamer->RequestStreamChange();
+    m_Receiver->RequestStreamChange();
 
     // write changed data back to the cache
     m_ChannelCache = cache;
@@ -402,9 +407,9 @@ void cLivePatFilter::Process(u_short Pid, u_char Tid, const u_char *Data, int Le
     }
 
 #if VDRVERSNUM < 20106 // VDR VERSION < 2.1.6
-    m_Streamer->Attach();
+    m_Receiver->Attach();
 #endif
 
-    m_Streamer->m_FilterMutex.Unlock();
+    m_Receiver->m_FilterMutex.Unlock();
   }
 }
@@ -33,7 +33,7 @@
 #include "demuxer/demuxer.h"
 #include "channelcache.h"
 
-class cLiveStreamer;
+class cLiveReceiver;
 
 class cLivePatFilter : public cFilter
 {
@@ -42,7 +42,7 @@ private:
   int             m_pmtSid;
   int             m_pmtVersion;
   const cChannel *m_Channel;
-  cLiveStreamer  *m_Streamer;
+  cLiveReceiver  *m_Receiver;
   cChannelCache   m_ChannelCache;
   cMutex          m_Mutex;
 
@@ -51,7 +51,7 @@ private:
   virtual void Process(u_short Pid, u_char Tid, const u_char *Data, int Length);
 
 public:
-  cLivePatFilter(cLiveStreamer *Streamer);
+  cLivePatFilter(cLiveReceiver *Receiver);
   void SetChannel(const cChannel *Channel);
 };
 
@@ -0,0 +1,221 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <string.h>
+#include <libsi/section.h>
+
+#include "demuxer/demuxer.h"
+#include "livepatpmt.h"
+
+cLivePatPmt::cLivePatPmt() : m_PatCounter(0), m_PmtCounter(0), m_Version(0), m_PmtPid(DefaultPmtPid), m_Valid(false)
+{
+  memset(m_Pat, 0xFF, sizeof(m_Pat));
+  memset(m_Pmt, 0xFF, sizeof(m_Pmt));
+}
+
+void cLivePatPmt::MakePacket(uchar* ts, int pid, uchar* section, int length)
+{
+  memset(ts, 0xFF, TS_SIZE);
+
+  ts[0] = TS_SYNC_BYTE;
+  ts[1] = 0x40 | ((pid >> 8) & 0x1F); // payload unit start
+  ts[2] = pid & 0xFF;
+  ts[3] = 0x10;                       // payload only, continuity counter is set on output
+  ts[4] = 0x00;                       // pointer field
+
+  memcpy(ts + 5, section, length);
+}
+
+int cLivePatPmt::PutCRC(uchar* section, int length)
+{
+  // section length (including CRC)
+  int len = length + 4 - 3;
+  section[1] = (section[1] & 0xF0) | ((len >> 8) & 0x0F);
+  section[2] = len & 0xFF;
+
+  uint32_t crc = SI::CRC32::crc32((const char*)section, length, 0xFFFFFFFF);
+  section[length++] = crc >> 24;
+  section[length++] = crc >> 16;
+  section[length++] = crc >> 8;
+  section[length++] = crc;
+
+  return length;
+}
+
+void cLivePatPmt::SetStreams(int sid, int tid, const std::list<cTSDemuxer*>& streams)
+{
+  uchar section[TS_SIZE];
+  int i = 0;
+
+  m_Version = (m_Version + 1) & 0x1F;
+
+  // the PMT pid must not collide with any of the elementary streams
+  m_PmtPid = DefaultPmtPid;
+
+  for (std::list<cTSDemuxer*>::const_iterator s = streams.begin(); s != streams.end();) {
+    if((*s)->GetPID() == m_PmtPid) {
+      m_PmtPid++;
+      s = streams.begin();
+      continue;
+    }
+    s++;
+  }
+
+  // PAT
+  section[i++] = 0x00;                          // table id
+  section[i++] = 0xB0;                          // section syntax indicator, length
+  section[i++] = 0x00;
+  section[i++] = (tid >> 8) & 0xFF;             // transport stream id
+  section[i++] = tid & 0xFF;
+  section[i++] = 0xC1 | (m_Version << 1);       // version, current / next
+  section[i++] = 0x00;                          // section number
+  section[i++] = 0x00;                          // last section number
+  section[i++] = (sid >> 8) & 0xFF;             // program number
+  section[i++] = sid & 0xFF;
+  section[i++] = 0xE0 | ((m_PmtPid >> 8) & 0x1F); // program map pid
+  section[i++] = m_PmtPid & 0xFF;
+
+  MakePacket(m_Pat, 0, section, PutCRC(section, i));
+
+  // PMT (PCR is carried with the video stream)
+  int pcrpid = 0x1FFF;
+
+  for (std::list<cTSDemuxer*>::const_iterator s = streams.begin(); s != streams.end(); s++) {
+    if((*s)->GetContent() == cStreamInfo::scVIDEO) {
+      pcrpid = (*s)->GetPID();
+      break;
+    }
+  }
+
+  i = 0;
+  section[i++] = 0x02;                          // table id
+  section[i++] = 0xB0;                          // section syntax indicator, length
+  section[i++] = 0x00;
+  section[i++] = (sid >> 8) & 0xFF;             // program number
+  section[i++] = sid & 0xFF;
+  section[i++] = 0xC1 | (m_Version << 1);       // version, current / next
+  section[i++] = 0x00;                          // section number
+  section[i++] = 0x00;                          // last section number
+  section[i++] = 0xE0 | ((pcrpid >> 8) & 0x1F); // PCR pid
+  section[i++] = pcrpid & 0xFF;
+  section[i++] = 0xF0;                          // program info length
+  section[i++] = 0x00;
+
+  for (std::list<cTSDemuxer*>::const_iterator s = streams.begin(); s != streams.end(); s++) {
+    cTSDemuxer* stream = *s;
+    uchar es[32];
+    int n = 0;
+    int type = 0x06; // private data
+
+    const char* lang = stream->GetLanguage();
+
+    switch(stream->GetType()) {
+      case cStreamInfo::stMPEG2VIDEO:
+        type = 0x02;
+        break;
+      case cStreamInfo::stH264:
+        type = 0x1B;
+        break;
+      case cStreamInfo::stMPEG2AUDIO:
+        type = 0x03;
+        break;
+      case cStreamInfo::stAAC:
+        type = 0x0F;
+        break;
+      case cStreamInfo::stLATM:
+        type = 0x11;
+        break;
+      case cStreamInfo::stAC3:
+        es[n++] = SI::AC3DescriptorTag;
+        es[n++] = 0x01;
+        es[n++] = 0x00;
+        break;
+      case cStreamInfo::stEAC3:
+        es[n++] = SI::EnhancedAC3DescriptorTag;
+        es[n++] = 0x01;
+        es[n++] = 0x00;
+        break;
+      case cStreamInfo::stDVBSUB:
+        es[n++] = SI::SubtitlingDescriptorTag;
+        es[n++] = 0x08;
+        es[n++] = lang[0];
+        es[n++] = lang[1];
+        es[n++] = lang[2];
+        es[n++] = stream->SubtitlingType();
+        es[n++] = (stream->CompositionPageId() >> 8) & 0xFF;
+        es[n++] = stream->CompositionPageId() & 0xFF;
+        es[n++] = (stream->AncillaryPageId() >> 8) & 0xFF;
+        es[n++] = stream->AncillaryPageId() & 0xFF;
+        break;
+      case cStreamInfo::stTELETEXT:
+        es[n++] = SI::TeletextDescriptorTag;
+        es[n++] = 0x00;
+        break;
+      default:
+        continue;
+    }
+
+    // audio language
+    if(stream->GetContent() == cStreamInfo::scAUDIO && lang[0] != 0) {
+      es[n++] = SI::ISO639LanguageDescriptorTag;
+      es[n++] = 0x04;
+      es[n++] = lang[0];
+      es[n++] = lang[1];
+      es[n++] = lang[2];
+      es[n++] = stream->GetAudioType();
+    }
+
+    // the PMT must fit into a single TS packet (pointer field and CRC)
+    if(i + 5 + n + 4 > TS_SIZE - 5) {
+      break;
+    }
+
+    section[i++] = type;
+    section[i++] = 0xE0 | ((stream->GetPID() >> 8) & 0x1F);
+    section[i++] = stream->GetPID() & 0xFF;
+    section[i++] = 0xF0 | ((n >> 8) & 0x0F);
+    section[i++] = n & 0xFF;
+
+    memcpy(section + i, es, n);
+    i += n;
+  }
+
+  MakePacket(m_Pmt, m_PmtPid, section, PutCRC(section, i));
+  m_Valid = true;
+}
+
+int cLivePatPmt::Put(uchar* data)
+{
+  if(!m_Valid) {
+    return 0;
+  }
+
+  m_Pat[3] = (m_Pat[3] & 0xF0) | (m_PatCounter++ & 0x0F);
+  m_Pmt[3] = (m_Pmt[3] & 0xF0) | (m_PmtCounter++ & 0x0F);
+
+  memcpy(data, m_Pat, TS_SIZE);
+  memcpy(data + TS_SIZE, m_Pmt, TS_SIZE);
+
+  return 2 * TS_SIZE;
+}
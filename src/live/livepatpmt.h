@@ -0,0 +1,63 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_LIVEPATPMT_H
+#define XVDR_LIVEPATPMT_H
+
+#include <vdr/remux.h>
+
+#include <list>
+
+class cTSDemuxer;
+
+// PAT / PMT generator for raw transport streams.
+// Describes a single service consisting of the streams sent to the client.
+
+class cLivePatPmt
+{
+private:
+
+  enum { DefaultPmtPid = 0x0084 };
+
+  uchar m_Pat[TS_SIZE];
+  uchar m_Pmt[TS_SIZE];
+  uchar m_PatCounter;
+  uchar m_PmtCounter;
+  int   m_Version;
+  int   m_PmtPid;
+  bool  m_Valid;
+
+  static void MakePacket(uchar* ts, int pid, uchar* section, int length);
+  static int PutCRC(uchar* section, int length);
+
+public:
+
+  cLivePatPmt();
+
+  void SetStreams(int sid, int tid, const std::list<cTSDemuxer*>& streams);
+
+  int Put(uchar* data);
+};
+
+#endif // XVDR_LIVEPATPMT_H
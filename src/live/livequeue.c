@@ -25,186 +25,557 @@
 #include <sys/types.h>
 #include <dirent.h>
 #include <unistd.h>
+#include <algorithm>
 
 #include "config/config.h"
 #include "net/msgpacket.h"
+#include "xvdr/xvdrcommand.h"
+#include "demuxer/demuxer.h"
+#include "xvdr/xvdrwriter.h"
 #include "livequeue.h"
+#include "livetimeshift.h"
 
 cString cLiveQueue::TimeShiftDir = "/video";
 uint64_t cLiveQueue::BufferSize = 1024*1024*1024;
+uint64_t cLiveQueue::MemorySize = MEGABYTE(64);
+uint32_t cLiveQueue::MaxQueueSize = MEGABYTE(4);
+int cLiveQueue::MaxQueueLatency = 2000;
 
-cLiveQueue::cLiveQueue(int sock) : m_socket(sock), m_readfd(-1), m_writefd(-1), m_queuesize(400)
+cLiveQueue::cLiveQueue(int sock, cXVDRWriter* writer) : m_socket(sock), m_writer(writer), m_timeshift(NULL), m_generation(0)
 {
   m_pause = false;
+  m_bytes = 0;
+  m_burst = false;
+  m_burstBytes = 0;
+  m_dropGOP = false;
+  m_droppedPackets = 0;
+  m_droppedBytes = 0;
+  m_creditBytes = 0;
+  m_creditPts = DVD_NOPTS_VALUE;
+
+  m_writer->SetStreamQueue(this);
 }
 
 cLiveQueue::~cLiveQueue()
 {
   DEBUGLOG("Deleting LiveQueue");
-  m_cond.Signal();
-  Cancel(3);
+  m_writer->SetStreamQueue(NULL);
   Cleanup();
   CloseTimeShift();
+  ReleaseTimeShift();
 }
 
 void cLiveQueue::Cleanup()
 {
   cMutexLock lock(&m_lock);
-  while(!empty())
+  while(!m_queue.empty())
   {
-    delete front();
-    pop();
+    delete Pop();
   }
+
+  m_dropGOP = false;
+
+  // the client grants a new window after flushing
+  m_creditBytes = 0;
+  m_creditPts = DVD_NOPTS_VALUE;
+
+  // packets taken by the sender are stale too
+  m_generation++;
 }
 
-void cLiveQueue::Request()
+void cLiveQueue::Reset()
 {
   cMutexLock lock(&m_lock);
 
-  // read packet from storage
-  MsgPacket* p = MsgPacket::read(m_readfd, 1000);
+  m_pause = false;
+  Cleanup();
+  RetireTimeShift();
+}
 
-  // check for buffer overrun
-  if(p == NULL)
+void cLiveQueue::RetireTimeShift()
+{
+  // stopping the storage thread may take a while, the caller
+  // releases the buffer once it doesn't hold any locks anymore
+  if(m_timeshift != NULL)
   {
-    // ring-buffer overrun ?
-    off_t pos = lseek(m_readfd, 0, SEEK_CUR);
-    if(pos < (off_t)BufferSize)
-      return;
-
-    lseek(m_readfd, 0, SEEK_SET);
-    p = MsgPacket::read(m_readfd, 1000);
+    m_retired.push_back(m_timeshift);
+    m_timeshift = NULL;
   }
+}
 
-  // no packet
-  if(p == NULL)
-    return;
+void cLiveQueue::ReleaseTimeShift()
+{
+  std::list<cLiveTimeShift*> retired;
 
-  // put packet into queue
-  push(p);
+  {
+    cMutexLock lock(&m_lock);
+    retired.swap(m_retired);
+  }
 
-  m_cond.Signal();
+  for(std::list<cLiveTimeShift*>::iterator i = retired.begin(); i != retired.end(); i++)
+  {
+    delete *i;
+  }
 }
 
-bool cLiveQueue::IsPaused()
+bool cLiveQueue::IsReady()
 {
   cMutexLock lock(&m_lock);
-  return m_pause;
+  return !m_queue.empty() || HasCredit();
 }
 
-bool cLiveQueue::TimeShiftMode()
+int cLiveQueue::Size()
 {
   cMutexLock lock(&m_lock);
-  return (m_pause || (!m_pause && m_writefd != -1));
+  return m_queue.size();
 }
 
-bool cLiveQueue::Add(MsgPacket* p, cStreamInfo::Content content)
+int cLiveQueue::Take(MsgPacket** batch, int max, int& generation)
 {
   cMutexLock lock(&m_lock);
+  int count = 0;
 
-  // in timeshift mode ?
-  if(m_pause || (!m_pause && m_writefd != -1))
+  generation = m_generation;
+
+  while(!m_queue.empty() && count < max)
   {
-    // write packet
-    if(!p->write(m_writefd, 1000))
+    batch[count++] = Pop();
+  }
+
+  // replay from the timeshift buffer as long as the client has credit
+  while(count < max && HasCredit())
+  {
+    MsgPacket* p = m_timeshift->Read();
+
+    if(p == NULL)
+      break;
+
+    uint32_t length = p->getPacketLength();
+    m_creditBytes = (length < m_creditBytes) ? m_creditBytes - length : 0;
+
+    batch[count++] = p;
+  }
+
+  return count;
+}
+
+bool cLiveQueue::HasCredit()
+{
+  if(m_pause || m_timeshift == NULL || !m_timeshift->HasData())
+    return false;
+
+  if(m_creditBytes > 0)
+    return true;
+
+  // media time is tracked by I-frames (GOP granularity)
+  return (m_creditPts != DVD_NOPTS_VALUE && m_timeshift->GetPosition() < m_creditPts);
+}
+
+bool cLiveQueue::IsStale(int generation)
+{
+  cMutexLock lock(&m_lock);
+  return (generation != m_generation);
+}
+
+void cLiveQueue::Request(uint32_t bytes, uint32_t ms)
+{
+  {
+    cMutexLock lock(&m_lock);
+
+    if(m_timeshift == NULL)
+      return;
+
+    // grant credit, the writer streams from the storage until it's used up
+    if(bytes > 0 || ms > 0)
     {
-      ERRORLOG("Unable to write packet into timeshift ringbuffer !");
-      delete p;
-      return false;
-    }
+      m_creditBytes = (bytes > 0xFFFFFFFF - m_creditBytes) ? 0xFFFFFFFF : m_creditBytes + bytes;
+
+      int64_t position = m_timeshift->GetPosition();
+
+      if(ms > 0 && position != DVD_NOPTS_VALUE)
+      {
+        if(m_creditPts == DVD_NOPTS_VALUE || m_creditPts < position)
+          m_creditPts = position;
 
-    // ring-buffer overrun ?
-    off_t length = lseek(m_writefd, 0, SEEK_CUR);
-    if(length >= (off_t)BufferSize)
+        // timestamps are in microseconds
+        m_creditPts += (int64_t)ms * 1000;
+      }
+    }
+    // single packet request
+    else
     {
-      // truncate to current position
-      if(ftruncate(m_writefd, length) == 0)
-        lseek(m_writefd, 0, SEEK_SET);
+      // read packet from storage
+      MsgPacket* p = m_timeshift->Read();
+
+      // no packet
+      if(p == NULL)
+        return;
+
+      // put packet into queue
+      Push(p, cStreamInfo::scSTREAMINFO);
     }
-    delete p;
-    return true;
   }
 
-  // discard teletext / signalinfo packets if the buffer fills up, ...
-  if(size() > (m_queuesize / 2)) {
-    if(content == cStreamInfo::scTELETEXT || content == cStreamInfo::scNONE) {
-      delete p;
-      m_cond.Signal();
-      return true;
+  // the writer must not be called with the queue locked
+  m_writer->Wakeup();
+}
+
+void cLiveQueue::Push(MsgPacket* p, cStreamInfo::Content content, cStreamInfo::FrameType frametype, int64_t pts)
+{
+  sQueueItem item;
+  item.packet = p;
+  item.content = content;
+  item.frametype = frametype;
+  item.pts = pts;
+  item.size = p->getPacketLength();
+  item.burst = m_burst;
+
+  m_queue.push_back(item);
+  m_bytes += item.size;
+
+  if(item.burst) {
+    m_burstBytes += item.size;
+  }
+}
+
+MsgPacket* cLiveQueue::Pop()
+{
+  MsgPacket* p = m_queue.front().packet;
+
+  m_bytes -= m_queue.front().size;
+
+  if(m_queue.front().burst) {
+    m_burstBytes -= m_queue.front().size;
+  }
+
+  m_queue.pop_front();
+
+  return p;
+}
+
+int cLiveQueue::GetLatency()
+{
+  // media time between the oldest and the newest queued audio frame
+  // (audio is continuous and never dropped)
+  int64_t first = DVD_NOPTS_VALUE;
+  int64_t last = DVD_NOPTS_VALUE;
+
+  for(std::deque<sQueueItem>::iterator i = m_queue.begin(); i != m_queue.end(); i++) {
+    if(i->content == cStreamInfo::scAUDIO && i->pts != DVD_NOPTS_VALUE && !i->burst) {
+      first = i->pts;
+      break;
     }
   }
 
-  // add packet to queue
-  push(p);
+  for(std::deque<sQueueItem>::reverse_iterator i = m_queue.rbegin(); i != m_queue.rend(); i++) {
+    if(i->content == cStreamInfo::scAUDIO && i->pts != DVD_NOPTS_VALUE && !i->burst) {
+      last = i->pts;
+      break;
+    }
+  }
 
-  // queue too long ?
-  while (size() > m_queuesize) {
-    p = front();
-    pop();
+  if(first == DVD_NOPTS_VALUE || last <= first) {
+    return 0;
   }
 
-  m_cond.Signal();
+  // timestamps are in microseconds
+  return (int)((last - first) / 1000);
+}
 
-  return true;
+cLiveQueue::DropLevel cLiveQueue::GetDropLevel()
+{
+  // queue occupancy in percent (bytes or media time, whatever is higher)
+  // a pending burst (cached GOP) isn't a sign of a slow client
+  uint64_t fill = (uint64_t)(m_bytes - m_burstBytes) * 100 / MaxQueueSize;
+
+  if(MaxQueueLatency > 0) {
+    fill = std::max(fill, (uint64_t)GetLatency() * 100 / MaxQueueLatency);
+  }
+
+  if(fill >= 100) {
+    return dlGOP;
+  }
+  if(fill >= 75) {
+    return dlBFRAMES;
+  }
+  if(fill >= 50) {
+    return dlSUBTITLES;
+  }
+
+  return dlNONE;
 }
 
-void cLiveQueue::Action()
+void cLiveQueue::Drop(MsgPacket* p)
 {
-  INFOLOG("LiveQueue started");
+  m_droppedPackets++;
+  m_droppedBytes += p->getPacketLength();
+  delete p;
+}
 
-  // wait for first packet
-  m_cond.Wait(0);
+bool cLiveQueue::DropOldestGOP()
+{
+  // audio, stream changes and the cached GOP are never dropped
+  bool dropped = false;
+  bool video = false;
+  std::deque<sQueueItem>::iterator i = m_queue.begin();
+
+  while(i != m_queue.end()) {
+    bool droppable = !i->burst && (
+      i->content == cStreamInfo::scVIDEO ||
+      i->content == cStreamInfo::scSUBTITLE ||
+      i->content == cStreamInfo::scTELETEXT ||
+      i->content == cStreamInfo::scRAWTS);
+
+    if(!droppable) {
+      i++;
+      continue;
+    }
 
-  while(Running())
-  {
-    MsgPacket* p = NULL;
+    // stop at the start of the next GOP
+    if(i->content == cStreamInfo::scVIDEO) {
+      if(video && i->frametype == cStreamInfo::ftIFRAME) {
+        break;
+      }
 
-    m_lock.Lock();
+      // frames aren't typed - stop as soon as there's room
+      if(video && i->frametype == cStreamInfo::ftUNKNOWN && m_bytes - m_burstBytes <= 2 * MaxQueueSize) {
+        break;
+      }
 
-    // just wait if we are paused
-    if(m_pause)
-    {
-      m_lock.Unlock();
-      m_cond.Wait(0);
-      m_lock.Lock();
+      video = true;
     }
 
-    // check packet queue
-    if(size() > 0)
-    {
-      p = front();
-      pop();
+    bool rawts = (i->content == cStreamInfo::scRAWTS);
+
+    m_bytes -= i->size;
+    Drop(i->packet);
+    i = m_queue.erase(i);
+    dropped = true;
+
+    // raw TS chunks (all streams) are dropped one by one
+    if(rawts) {
+      break;
     }
+  }
 
-    m_lock.Unlock();
+  return dropped;
+}
 
-    // no packets to send
-    if(p == NULL)
+void cLiveQueue::SendQueueStatus(DropLevel level)
+{
+  if(m_droppedPackets == 0 || !m_statusTimer.TimedOut()) {
+    return;
+  }
+
+  MsgPacket* p = new MsgPacket(XVDR_STREAM_QUEUESTATUS, XVDR_CHANNEL_STREAM);
+
+  p->put_U32(m_droppedPackets);
+  p->put_U32(m_droppedBytes);
+  p->put_U32(level);
+  p->put_U32(m_bytes);
+  p->put_U32(GetLatency());
+
+  DEBUGLOG("Dropped %u packets (%u bytes) - drop level %i, %u bytes queued", m_droppedPackets, m_droppedBytes, level, m_bytes);
+
+  m_droppedPackets = 0;
+  m_droppedBytes = 0;
+  m_statusTimer.Set(1000);
+
+  // the report is sent ahead of the queued packets
+  sQueueItem item;
+  item.packet = p;
+  item.content = cStreamInfo::scSTREAMINFO;
+  item.frametype = cStreamInfo::ftUNKNOWN;
+  item.pts = DVD_NOPTS_VALUE;
+  item.size = p->getPacketLength();
+  item.burst = false;
+
+  m_queue.push_front(item);
+  m_bytes += item.size;
+}
+
+void cLiveQueue::SetBurst(bool on)
+{
+  cMutexLock lock(&m_lock);
+  m_burst = on;
+}
+
+bool cLiveQueue::IsPaused()
+{
+  cMutexLock lock(&m_lock);
+  return m_pause;
+}
+
+bool cLiveQueue::TimeShiftMode()
+{
+  cMutexLock lock(&m_lock);
+  return (m_pause || m_timeshift != NULL);
+}
+
+bool cLiveQueue::Seek(int64_t pts, bool relative)
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_timeshift == NULL)
+    return false;
+
+  // relative offsets are in milliseconds (timestamps in microseconds)
+  if(relative) {
+    int64_t position = m_timeshift->GetPosition();
+
+    if(position == DVD_NOPTS_VALUE)
+      return false;
+
+    pts = position + pts * 1000;
+  }
+
+  if(!m_timeshift->Seek(pts))
+    return false;
+
+  // discard packets read ahead from the old position
+  Cleanup();
+  return true;
+}
+
+bool cLiveQueue::GetTimeShiftRange(int64_t& position, int64_t& start, int64_t& end)
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_timeshift == NULL || !m_timeshift->GetRange(start, end))
+    return false;
+
+  position = m_timeshift->GetPosition();
+  return true;
+}
+
+bool cLiveQueue::GetTimeShiftStats(uint32_t& staged, uint32_t& stalls)
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_timeshift == NULL)
+    return false;
+
+  staged = m_timeshift->GetStagedBytes();
+  stalls = m_timeshift->GetStalls();
+  return true;
+}
+
+bool cLiveQueue::Add(MsgPacket* p, cStreamInfo::Content content, cStreamInfo::FrameType frametype, int64_t pts)
+{
+  bool rc = AddPacket(p, content, frametype, pts);
+
+  // the writer must not be called with the queue locked
+  m_writer->Wakeup();
+
+  return rc;
+}
+
+bool cLiveQueue::AddPacket(MsgPacket* p, cStreamInfo::Content content, cStreamInfo::FrameType frametype, int64_t pts)
+{
+  cMutexLock lock(&m_lock);
+
+  // timeshift buffer couldn't be created - continue live
+  if(m_timeshift != NULL && m_timeshift->Failed())
+  {
+    ERRORLOG("Timeshift buffer not available - leaving timeshift mode");
+    m_pause = false;
+    RetireTimeShift();
+  }
+
+  // in timeshift mode ?
+  if(m_pause || m_timeshift != NULL)
+  {
+    // write packet
+    if(m_timeshift == NULL)
     {
-      m_cond.Wait(3000);
-      continue;
-    }
-    // send packet
-    else {
-      p->write(m_socket, 500);
+      ERRORLOG("Unable to write packet into timeshift ringbuffer !");
       delete p;
+      return false;
     }
 
+    // the packet is stored asynchronously
+    return m_timeshift->Write(p, content, frametype, pts);
+  }
+
+  // cached GOP for a starting client - sent as a whole
+  if(m_burst) {
+    Push(p, content, frametype, pts);
+    return true;
   }
 
-  INFOLOG("LiveQueue stopped");
+  DropLevel level = GetDropLevel();
+  bool drop = false;
+
+  switch(content) {
+    // discard subtitles / teletext / signalinfo packets first
+    case cStreamInfo::scSUBTITLE:
+    case cStreamInfo::scTELETEXT:
+    case cStreamInfo::scNONE:
+      drop = (level >= dlSUBTITLES);
+      break;
+
+    case cStreamInfo::scVIDEO:
+      // skipping the rest of the GOP
+      if(m_dropGOP) {
+        // resume with the next I-frame (or as soon as there's room if frames aren't typed)
+        bool resume = (frametype == cStreamInfo::ftIFRAME && level < dlGOP) ||
+                      (frametype == cStreamInfo::ftUNKNOWN && level < dlBFRAMES);
+        m_dropGOP = !resume;
+        drop = m_dropGOP;
+      }
+      // skip the whole GOP
+      else if(level >= dlGOP) {
+        INFOLOG("client too slow - skipping video up to the next I-frame");
+        m_dropGOP = true;
+        drop = true;
+      }
+      // B-frames aren't referenced by other frames
+      else if(level >= dlBFRAMES && frametype == cStreamInfo::ftBFRAME) {
+        drop = true;
+      }
+      break;
+
+    // raw TS chunks contain all streams (can't be thinned out, the hard limit drops whole chunks)
+    case cStreamInfo::scRAWTS:
+      break;
+
+    // audio and stream information is always sent
+    default:
+      break;
+  }
+
+  if(drop) {
+    Drop(p);
+  }
+  else {
+    Push(p, content, frametype, pts);
+  }
+
+  // hard limit: drop the oldest GOPs
+  while(m_bytes - m_burstBytes > 2 * MaxQueueSize) {
+    if(!DropOldestGOP()) {
+      break;
+    }
+  }
+
+  SendQueueStatus(level);
+
+  return true;
 }
 
 void cLiveQueue::CloseTimeShift()
 {
-  close(m_readfd);
-  m_readfd = -1;
-  close(m_writefd);
-  m_writefd = -1;
+  cLiveTimeShift* timeshift = NULL;
 
-  if(*m_storage) {
-    unlink(m_storage);
+  {
+    cMutexLock lock(&m_lock);
+    timeshift = m_timeshift;
+    m_timeshift = NULL;
   }
+
+  // the storage thread wakes up the writer, which in turn may be
+  // waiting for the queue lock (must not be held here)
+  delete timeshift;
 }
 
 bool cLiveQueue::Pause(bool on)
@@ -215,7 +586,6 @@ bool cLiveQueue::Pause(bool on)
   if(!on)
   {
     m_pause = false;
-    m_cond.Signal();
     return true;
   }
 
@@ -223,34 +593,22 @@ bool cLiveQueue::Pause(bool on)
     return false;
 
   // create offline storage
-  if(m_readfd == -1)
+  if(m_timeshift == NULL)
   {
-    m_storage = cString::sprintf("%s/xvdr-ringbuffer-%05i.data", (const char*)TimeShiftDir, m_socket);
-    DEBUGLOG("FILE: %s", (const char*)m_storage);
-
-    m_readfd = open(m_storage, O_CREAT | O_RDONLY, 0644);
-    m_writefd = open(m_storage, O_CREAT | O_WRONLY, 0644);
-    lseek(m_readfd, 0, SEEK_SET);
-    lseek(m_writefd, 0, SEEK_SET);
-
-    if(m_readfd == -1) {
-      ERRORLOG("Failed to create timeshift ringbuffer !");
-    }
+    m_timeshift = new cLiveTimeShift(TimeShiftDir, m_socket, BufferSize, MemorySize, m_writer);
   }
 
   m_pause = true;
 
   // push all packets from the queue to the offline storage
-  DEBUGLOG("Writing %i packets into timeshift buffer", size());
+  DEBUGLOG("Writing %i packets into timeshift buffer", (int)m_queue.size());
 
-  while(!empty())
+  while(!m_queue.empty())
   {
-    MsgPacket* p = front();
-
-    p->write(m_writefd, 1000);
-    delete p;
+    sQueueItem item = m_queue.front();
+    MsgPacket* p = Pop();
 
-    pop();
+    m_timeshift->Write(p, item.content, item.frametype, item.pts);
   }
 
   return true;
@@ -268,6 +626,24 @@ void cLiveQueue::SetBufferSize(uint64_t s)
   DEBUGLOG("BUFFSERIZE: %llu bytes", BufferSize);
 }
 
+void cLiveQueue::SetMemorySize(uint64_t s)
+{
+  MemorySize = s;
+  DEBUGLOG("TIMESHIFTMEMORY: %llu bytes", MemorySize);
+}
+
+void cLiveQueue::SetMaxQueueSize(uint32_t bytes)
+{
+  MaxQueueSize = (bytes < MEGABYTE(1)) ? MEGABYTE(1) : bytes;
+  DEBUGLOG("MAXQUEUESIZE: %u bytes", MaxQueueSize);
+}
+
+void cLiveQueue::SetMaxQueueLatency(int ms)
+{
+  MaxQueueLatency = (ms < 0) ? 0 : ms;
+  DEBUGLOG("MAXQUEUELATENCY: %i ms", MaxQueueLatency);
+}
+
 void cLiveQueue::RemoveTimeShiftFiles()
 {
   DIR* dir = opendir((const char*)TimeShiftDir);
@@ -25,23 +25,29 @@
 #ifndef XVDR_LIVEQUEUE_H
 #define XVDR_LIVEQUEUE_H
 
-#include <queue>
+#include <deque>
+#include <list>
 #include <vdr/thread.h>
 #include "demuxer/streaminfo.h"
 
 class MsgPacket;
+class cXVDRWriter;
+class cLiveTimeShift;
 
-class cLiveQueue : public cThread, protected std::queue<MsgPacket*>
+// Stream lane of a client connection.
+// Packets are sent by the writer of the connection (cXVDRWriter).
+
+class cLiveQueue
 {
 public:
 
-  cLiveQueue(int s);
+  cLiveQueue(int s, cXVDRWriter* writer);
 
   virtual ~cLiveQueue();
 
-  bool Add(MsgPacket* p, cStreamInfo::Content content);
+  bool Add(MsgPacket* p, cStreamInfo::Content content, cStreamInfo::FrameType frametype = cStreamInfo::ftUNKNOWN, int64_t pts = 0);
 
-  void Request();
+  void Request(uint32_t bytes = 0, uint32_t ms = 0);
 
   bool Pause(bool on = true);
 
@@ -49,39 +55,127 @@ public:
 
   bool TimeShiftMode();
 
+  void SetBurst(bool on);
+
+  bool Seek(int64_t pts, bool relative = false);
+
+  bool GetTimeShiftRange(int64_t& position, int64_t& start, int64_t& end);
+
+  bool GetTimeShiftStats(uint32_t& staged, uint32_t& stalls);
+
   static void SetTimeShiftDir(const cString& dir);
 
   static void SetBufferSize(uint64_t s);
 
+  static void SetMemorySize(uint64_t s);
+
+  static void SetMaxQueueSize(uint32_t bytes);
+
+  static void SetMaxQueueLatency(int ms);
+
   static void RemoveTimeShiftFiles();
 
   void Cleanup();
 
+  void Reset();
+
+  void RetireTimeShift();
+
+  void ReleaseTimeShift();
+
+  bool IsReady();
+
+  int Size();
+
+  int Take(MsgPacket** batch, int max, int& generation);
+
+  bool IsStale(int generation);
+
 protected:
 
-  void Action();
+  // packets are dropped in this order if the client falls behind
+  enum DropLevel {
+    dlNONE,
+    dlSUBTITLES,  // subtitles, teletext and signal information
+    dlBFRAMES,    // B-frames
+    dlGOP,        // video up to the next I-frame
+  };
+
+  struct sQueueItem {
+    MsgPacket*             packet;
+    cStreamInfo::Content   content;
+    cStreamInfo::FrameType frametype;
+    int64_t                pts;
+    uint32_t               size;
+    bool                   burst;
+  };
+
+  bool AddPacket(MsgPacket* p, cStreamInfo::Content content, cStreamInfo::FrameType frametype, int64_t pts);
 
   void CloseTimeShift();
 
+  bool HasCredit();
+
+  void Push(MsgPacket* p, cStreamInfo::Content content, cStreamInfo::FrameType frametype = cStreamInfo::ftUNKNOWN, int64_t pts = 0);
+
+  MsgPacket* Pop();
+
+  int GetLatency();
+
+  DropLevel GetDropLevel();
+
+  void Drop(MsgPacket* p);
+
+  bool DropOldestGOP();
+
+  void SendQueueStatus(DropLevel level);
+
+  std::deque<sQueueItem> m_queue;
+
+  uint32_t m_bytes;
+
+  // packets sent in one go (cached GOP), not subject to the drop policy
+  bool m_burst;
+
+  uint32_t m_burstBytes;
+
+  bool m_dropGOP;
+
+  uint32_t m_droppedPackets;
+
+  uint32_t m_droppedBytes;
+
+  cTimeMs m_statusTimer;
+
   int m_socket;
 
-  int m_readfd;
+  cXVDRWriter* m_writer;
 
-  int m_writefd;
+  cLiveTimeShift* m_timeshift;
+
+  // detached by RetireTimeShift(), deleted by ReleaseTimeShift()
+  std::list<cLiveTimeShift*> m_retired;
 
   bool m_pause;
 
   cMutex m_lock;
 
-  cCondWait m_cond;
+  int m_generation;
 
-  cString m_storage;
+  // replay credit granted by the client (timeshift mode)
+  uint32_t m_creditBytes;
 
-  int m_queuesize;
+  int64_t m_creditPts;
 
   static cString TimeShiftDir;
 
   static uint64_t BufferSize;
+
+  static uint64_t MemorySize;
+
+  static uint32_t MaxQueueSize;
+
+  static int MaxQueueLatency;
 };
 
 #endif // XVDR_LIVEQUEUE_H
@@ -0,0 +1,904 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2010 Alwin Esch (Team XBMC)
+ *      Copyright (C) 2010, 2011 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <time.h>
+#include <string.h>
+#include <vdr/i18n.h>
+#include <vdr/remux.h>
+#include <vdr/channels.h>
+#include <vdr/timers.h>
+
+#include "config/config.h"
+#include "net/msgpacket.h"
+#include "xvdr/xvdrcommand.h"
+#include "tools/hash.h"
+
+#include "livereceiver.h"
+#include "livestreamer.h"
+#include "livepatfilter.h"
+#include "livequeue.h"
+#include "channelcache.h"
+
+std::list<cLiveReceiver*> cLiveReceiver::m_Receivers;
+uint32_t cLiveReceiver::m_CacheSize = MEGABYTE(8);
+cMutex cLiveReceiver::m_ReceiversMutex;
+
+cLiveReceiver::cLiveReceiver(const cChannel *channel, int priority)
+ : cThread("cLiveReceiver stream processor")
+ , cRingBufferLinear(MEGABYTE(10), TS_SIZE * 2, true)
+ , cReceiver(NULL, priority)
+ , m_scanTimeout(10)
+{
+  m_Device          = NULL;
+  m_startup         = true;
+  m_SignalLost      = false;
+  m_uid             = CreateChannelUID(channel);
+  m_priority        = priority;
+  m_generation      = 0;
+  m_ready           = false;
+  m_PatFilter       = NULL;
+  m_CacheBytes      = 0;
+  m_warmStart       = false;
+  m_warmPending     = false;
+
+  memset(m_PidTable, 0, sizeof(m_PidTable));
+
+  m_requestStreamChange = false;
+
+  if(m_scanTimeout == 0)
+    m_scanTimeout = XVDRServerConfig.stream_timeout;
+
+  SetTimeouts(0, 10);
+  Start();
+}
+
+cLiveReceiver::~cLiveReceiver()
+{
+  DEBUGLOG("Started to delete live receiver");
+
+  cTimeMs t;
+
+  DEBUGLOG("Stopping receiver thread ...");
+  Cancel(5);
+  DEBUGLOG("Done.");
+
+  cMutexLock lock(&m_FilterMutex);
+
+  DEBUGLOG("Detaching");
+
+  if(m_PatFilter != NULL && m_Device != NULL) {
+    m_Device->Detach(m_PatFilter);
+    delete m_PatFilter;
+    m_PatFilter = NULL;
+  }
+
+  if (IsAttached()) {
+    Detach();
+  }
+
+  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++) {
+    if ((*i) != NULL) {
+      DEBUGLOG("Deleting stream demuxer for pid=%i and type=%i", (*i)->GetPID(), (*i)->GetType());
+      delete (*i);
+    }
+  }
+  m_Demuxers.clear();
+  UpdatePidTable();
+
+  clearCache();
+
+  m_uid = 0;
+
+  {
+    cMutexLock lock(&m_DeviceMutex);
+    m_Device = NULL;
+  }
+
+  DEBUGLOG("Finished to delete live receiver (took %llu ms)", t.Elapsed());
+}
+
+cLiveReceiver* cLiveReceiver::Subscribe(cLiveStreamer* streamer, const cChannel *channel, int priority)
+{
+  cMutexLock lock(&m_ReceiversMutex);
+  uint32_t uid = CreateChannelUID(channel);
+
+  // join a running session of this channel (with the same priority,
+  // the device has been chosen for the priority of the session)
+  for (std::list<cLiveReceiver*>::iterator i = m_Receivers.begin(); i != m_Receivers.end(); i++) {
+    if ((*i)->m_uid == uid && (*i)->m_priority == priority) {
+      INFOLOG("Sharing receiver of channel %i - %s", channel->Number(), channel->Name());
+      (*i)->AddStreamer(streamer);
+      (*i)->UpdateDemuxers();
+      return *i;
+    }
+  }
+
+  cLiveReceiver* receiver = new cLiveReceiver(channel, priority);
+  receiver->AddStreamer(streamer);
+  m_Receivers.push_back(receiver);
+
+  return receiver;
+}
+
+void cLiveReceiver::Unsubscribe(cLiveReceiver* receiver, cLiveStreamer* streamer)
+{
+  cMutexLock lock(&m_ReceiversMutex);
+
+  if(receiver->RemoveStreamer(streamer) > 0) {
+    receiver->UpdateDemuxers();
+    return;
+  }
+
+  // last client gone
+  m_Receivers.remove(receiver);
+  delete receiver;
+}
+
+cLiveReceiver* cLiveReceiver::Retune(cLiveReceiver* receiver, cLiveStreamer* streamer, const cChannel *channel, int priority)
+{
+  cMutexLock lock(&m_ReceiversMutex);
+  uint32_t uid = CreateChannelUID(channel);
+
+  bool shared = false;
+  for (std::list<cLiveReceiver*>::iterator i = m_Receivers.begin(); i != m_Receivers.end(); i++) {
+    if ((*i)->m_uid == uid && (*i)->m_priority == priority) {
+      shared = true;
+      break;
+    }
+  }
+
+  // we are the only client -> keep the receiver (thread and buffers) and switch it in place
+  if(!shared && receiver->m_priority == priority) {
+    cMutexLock filterLock(&receiver->m_FilterMutex);
+    cMutexLock streamerLock(&receiver->m_StreamerMutex);
+
+    if(receiver->m_Streamers.size() == 1) {
+      INFOLOG("Retuning receiver to channel %i - %s", channel->Number(), channel->Name());
+      receiver->Retune(channel);
+      streamer->Reset(channel);
+      return receiver;
+    }
+  }
+
+  // no packets are delivered to the streamer in between
+  Unsubscribe(receiver, streamer);
+  streamer->Reset(channel);
+
+  return Subscribe(streamer, channel, priority);
+}
+
+void cLiveReceiver::Retune(const cChannel *channel)
+{
+  cMutexLock lock(&m_FilterMutex);
+
+  if(m_PatFilter != NULL && m_Device != NULL) {
+    m_Device->Detach(m_PatFilter);
+    delete m_PatFilter;
+    m_PatFilter = NULL;
+  }
+
+  if(IsAttached()) {
+    Detach();
+  }
+
+  // drop demuxers of the previous channel (their stream information doesn't apply anymore)
+  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++) {
+    delete (*i);
+  }
+  m_Demuxers.clear();
+  UpdatePidTable();
+
+  clearCache();
+
+  // buffered TS data is discarded by the receiver thread
+  __sync_add_and_fetch(&m_generation, 1);
+
+  m_uid = CreateChannelUID(channel);
+  m_startup = true;
+  m_ready = false;
+  m_warmStart = false;
+  m_warmPending = false;
+  m_SignalLost = false;
+  m_requestStreamChange = false;
+  m_last_tick.Set(0);
+
+  // the receiver thread switches to the new channel when it finds us detached
+}
+
+bool cLiveReceiver::IsSelected(const cStreamInfo& info)
+{
+  cMutexLock lock(&m_StreamerMutex);
+
+  if(m_Streamers.empty()) {
+    return true;
+  }
+
+  for (std::list<cLiveStreamer*>::iterator i = m_Streamers.begin(); i != m_Streamers.end(); i++) {
+    if((*i)->IsSelected(info.GetPID(), info.GetType())) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void cLiveReceiver::UpdateDemuxers()
+{
+  cMutexLock lock(&m_FilterMutex);
+
+  // not tuned yet (demuxers will be created on switch)
+  if(!IsAttached()) {
+    return;
+  }
+
+  cChannelCache cache = cChannelCache::GetFromCache(m_uid);
+
+  if(cache.size() == 0) {
+    return;
+  }
+
+  // all PIDs of the channel are received, only the demuxers of the streams
+  // which have been added or removed are changed. The parsers of all
+  // other streams (and the GOP cache) are kept.
+  std::set<int> current;
+  int removed = 0;
+  int added = 0;
+
+  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end();) {
+    if(IsSelected(**i)) {
+      current.insert((*i)->GetPID());
+      i++;
+      continue;
+    }
+
+    delete *i;
+    i = m_Demuxers.erase(i);
+    removed++;
+  }
+
+  for (cChannelCache::iterator i = cache.begin(); i != cache.end(); i++) {
+    if(!IsSelected(i->second) || current.find(i->first) != current.end()) {
+      continue;
+    }
+
+    cTSDemuxer* dmx = new cTSDemuxer(this, i->second);
+    dmx->info();
+    m_Demuxers.push_back(dmx);
+    added++;
+  }
+
+  if(removed == 0 && added == 0) {
+    return;
+  }
+
+  UpdatePidTable();
+
+  INFOLOG("Subscribed streams changed (%i added, %i removed)", added, removed);
+}
+
+void cLiveReceiver::AddStreamer(cLiveStreamer* streamer)
+{
+  cMutexLock lock(&m_StreamerMutex);
+
+  // start with the cached GOP (sent with the next live packet)
+  streamer->m_replayCache = !m_Streamers.empty();
+  m_Streamers.push_back(streamer);
+}
+
+int cLiveReceiver::RemoveStreamer(cLiveStreamer* streamer)
+{
+  cMutexLock lock(&m_StreamerMutex);
+
+  m_Streamers.remove(streamer);
+  return m_Streamers.size();
+}
+
+void cLiveReceiver::SetTimeout(uint32_t timeout) {
+  m_scanTimeout = timeout;
+}
+
+void cLiveReceiver::SetGOPCacheSize(uint32_t size) {
+  m_CacheSize = size;
+}
+
+void cLiveReceiver::RequestStreamChange()
+{
+  m_requestStreamChange = true;
+}
+
+void cLiveReceiver::TryChannelSwitch() {
+  // find channel from uid
+  const cChannel* channel = FindChannelByUID(m_uid);
+
+  // try to switch channel
+  int rc = SwitchChannel(channel);
+
+  // succeeded -> exit
+  if(rc == XVDR_RET_OK) {
+    return;
+  }
+
+  // time limit not exceeded -> relax & exit
+  if(m_last_tick.Elapsed() < (uint64_t)(m_scanTimeout*1000)) {
+    cCondWait::SleepMs(10);
+    return;
+  }
+
+  // push notification after timeout
+  switch(rc) {
+    case XVDR_RET_ENCRYPTED:
+      ERRORLOG("Unable to decrypt channel %i - %s", channel->Number(), channel->Name());
+      sendStatusMessage(tr("Unable to decrypt channel"));
+      break;
+    case XVDR_RET_DATALOCKED:
+      ERRORLOG("Can't get device for channel %i - %s", channel->Number(), channel->Name());
+      sendStatusMessage(tr("All tuners busy"));
+      break;
+    case XVDR_RET_RECRUNNING:
+      ERRORLOG("Active recording blocking channel %i - %s", channel->Number(), channel->Name());
+      sendStatusMessage(tr("Blocked by active recording"));
+      break;
+    case XVDR_RET_ERROR:
+      ERRORLOG("Error switching to channel %i - %s", channel->Number(), channel->Name());
+      sendStatusMessage(tr("Failed to switch"));
+      break;
+  }
+
+  m_last_tick.Set(0);
+}
+
+void cLiveReceiver::Action(void)
+{
+  int size = 0;
+  unsigned char *buf = NULL;
+  m_startup = true;
+
+  // reset timer
+  m_last_tick.Set(0);
+
+  INFOLOG("receiver thread started.");
+
+  int cleared = m_generation;
+
+  while (Running())
+  {
+    // read the generation before the data, so any flush in between is detected
+    int generation = m_generation;
+
+    // flushed by Retune() -> discard the buffered data
+    // (the ring buffer may only be cleared by the reading thread)
+    if (generation != cleared)
+    {
+      Clear();
+      cleared = generation;
+    }
+
+    size = 0;
+    buf = Get(size);
+
+    // try to switch channel if we aren't attached yet
+    {
+      cMutexLock lock(&m_FilterMutex);
+      if (!IsAttached()) {
+        TryChannelSwitch();
+      }
+    }
+
+    // buffer has been flushed in the meantime -> data is stale
+    if (generation != m_generation)
+      continue;
+
+    if(!IsStarting() && (m_last_tick.Elapsed() > (uint64_t)(m_scanTimeout*1000)) && !m_SignalLost)
+    {
+      INFOLOG("timeout. signal lost!");
+      sendStatus(XVDR_STREAM_STATUS_SIGNALLOST);
+      m_SignalLost = true;
+
+      // retune to restore
+      cMutexLock lock(&m_FilterMutex);
+      clearCache();
+
+      if(m_PatFilter != NULL && m_Device != NULL) {
+        m_Device->Detach(m_PatFilter);
+        delete m_PatFilter;
+        m_PatFilter = NULL;
+      }
+
+      if(IsAttached()) {
+        Detach();
+      }
+    }
+
+    // no data
+    if (buf == NULL || size <= TS_SIZE)
+      continue;
+
+    // process all TS packets of the chunk at once
+    int used = 0;
+
+    // parsing is only needed for clients receiving demuxed packets
+    bool parse = true;
+    bool raw = false;
+    GetStreamingModes(parse, raw);
+
+    {
+      cMutexLock lock(&m_FilterMutex);
+
+      // flushed while we were waiting for the lock
+      if (generation != m_generation)
+        continue;
+
+      while (size - used >= TS_SIZE && Running())
+      {
+        uchar* p = buf + used;
+
+        // TS packet sync lost -> skip to the next sync byte
+        if (p[0] != TS_SYNC_BYTE || (size - used > TS_SIZE && p[TS_SIZE] != TS_SYNC_BYTE))
+        {
+          uchar* sync = (uchar*)memchr(p + 1, TS_SYNC_BYTE, size - used - 1);
+          used = (sync == NULL) ? size : (sync - buf);
+          continue;
+        }
+
+        cTSDemuxer *demuxer = FindStreamDemuxer(TsPid(p));
+
+        if (demuxer && parse)
+          demuxer->ProcessTSPacket(p);
+
+        used += TS_SIZE;
+      }
+
+      // forward the (PID filtered) chunk to raw TS clients
+      if (raw && used > 0)
+        sendRawTS(buf, used, parse);
+    }
+
+    Del(used);
+  }
+
+  INFOLOG("receiver thread ended.");
+}
+
+int cLiveReceiver::SwitchChannel(const cChannel *channel)
+{
+  if (channel == NULL) {
+    return XVDR_RET_ERROR;
+  }
+
+  m_warmStart = false;
+  m_warmPending = false;
+
+  if(m_PatFilter != NULL && m_Device != NULL) {
+    m_Device->Detach(m_PatFilter);
+    delete m_PatFilter;
+    m_PatFilter = NULL;
+  }
+
+  if(IsAttached()) {
+    Detach();
+  }
+
+  // check if any device is able to decrypt the channel - code taken from VDR
+  int NumUsableSlots = 0;
+
+  if (channel->Ca() >= CA_ENCRYPTED_MIN) {
+    for (cCamSlot *CamSlot = CamSlots.First(); CamSlot; CamSlot = CamSlots.Next(CamSlot)) {
+      if (CamSlot->ModuleStatus() == msReady) {
+        if (CamSlot->ProvidesCa(channel->Caids())) {
+          if (!ChannelCamRelations.CamChecked(channel->GetChannelID(), CamSlot->SlotNumber())) {
+            NumUsableSlots++;
+          }
+       }
+      }
+    }
+    if (!NumUsableSlots) {
+      return XVDR_RET_ENCRYPTED;
+    }
+  }
+
+  // get device for this channel
+  {
+    cMutexLock lock(&m_DeviceMutex);
+    m_Device = cDevice::GetDevice(channel, LIVEPRIORITY, false);
+  }
+
+  if (m_Device == NULL)
+  {
+    // return status "recording running" if there is an active timer
+    time_t now = time(NULL);
+
+    for (cTimer *ti = Timers.First(); ti; ti = Timers.Next(ti)) {
+      if (ti->Recording() && ti->Matches(now)) {
+        return XVDR_RET_RECRUNNING;
+      }
+    }
+
+    return XVDR_RET_DATALOCKED;
+  }
+
+  INFOLOG("Found available device %d", m_Device->DeviceNumber() + 1);
+
+  if (!m_Device->SwitchChannel(channel, false))
+  {
+    ERRORLOG("Can't switch to channel %i - %s", channel->Number(), channel->Name());
+    return XVDR_RET_ERROR;
+  }
+
+  // get cached demuxer data
+  cChannelCache cache = cChannelCache::GetFromCache(m_uid);
+
+  // channel already in cache
+  if(cache.size() != 0) {
+    INFOLOG("Channel information found in cache");
+  }
+  // channel not found in cache -> add it from vdr
+  else {
+    INFOLOG("adding channel to cache");
+    cChannelCache::AddToCache(channel);
+    cache = cChannelCache::GetFromCache(m_uid);
+  }
+
+  // recheck cache item
+  cChannelCache currentitem = cChannelCache::ItemFromChannel(channel);
+  if(!currentitem.ismetaof(cache)) {
+    INFOLOG("current channel differs from cache item - updating");
+    cache = currentitem;
+    cChannelCache::AddToCache(m_uid, cache);
+  }
+
+  if(cache.size() != 0) {
+    INFOLOG("Creating demuxers");
+    cache.CreateDemuxers(this);
+  }
+
+  RequestStreamChange();
+
+  INFOLOG("Successfully switched to channel %i - %s", channel->Number(), channel->Name());
+
+  // clear cached data
+  Clear();
+  clearCache();
+  __sync_add_and_fetch(&m_generation, 1);
+
+  {
+    cMutexLock lock(&m_StreamerMutex);
+    for (std::list<cLiveStreamer*>::iterator i = m_Streamers.begin(); i != m_Streamers.end(); i++) {
+      (*i)->Cleanup();
+    }
+  }
+
+  m_uid = CreateChannelUID(channel);
+
+  if(!Attach()) {
+    INFOLOG("Unable to attach receiver !");
+    return XVDR_RET_DATALOCKED;
+  }
+
+  INFOLOG("Starting PAT scanner");
+  m_PatFilter = new cLivePatFilter(this);
+  m_PatFilter->SetChannel(channel);
+  m_Device->AttachFilter(m_PatFilter);
+
+  // warm start: all streams are known from the cache. The clients are
+  // informed as soon as the PMT filter has confirmed the cached streams
+  // (without waiting for the parsers).
+  m_warmPending = (cache.size() != 0 && cache.IsParsed());
+
+  INFOLOG("done switching.");
+  return XVDR_RET_OK;
+}
+
+void cLiveReceiver::ConfirmStreams()
+{
+  cMutexLock lock(&m_FilterMutex);
+
+  // streaming has already been started the regular way
+  if(!m_warmPending || !m_startup) {
+    m_warmPending = false;
+    return;
+  }
+
+  INFOLOG("PMT matches cache - sending stream information");
+
+  m_warmPending = false;
+  m_warmStart = true;
+  m_ready = true;
+  m_requestStreamChange = false;
+
+  cMutexLock streamerLock(&m_StreamerMutex);
+  for (std::list<cLiveStreamer*>::iterator i = m_Streamers.begin(); i != m_Streamers.end(); i++) {
+    (*i)->sendStreamChange();
+  }
+}
+
+void cLiveReceiver::UpdatePidTable()
+{
+  memset(m_PidTable, 0, sizeof(m_PidTable));
+
+  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
+    if ((*i) != NULL)
+      m_PidTable[(*i)->GetPID() & (PidTableSize - 1)] = (*i);
+}
+
+bool cLiveReceiver::Attach(void)
+{
+  if (m_Device == NULL) {
+    return false;
+  }
+
+  return m_Device->AttachReceiver(this);
+}
+
+void cLiveReceiver::Detach(void)
+{
+  if (m_Device) {
+    m_Device->Detach(this);
+  }
+}
+
+void cLiveReceiver::sendStreamPacket(sStreamPacket *pkt)
+{
+  bool bReady = IsReady();
+
+  if(!bReady || pkt == NULL || pkt->size == 0)
+    return;
+
+  bool av = (pkt->content == cStreamInfo::scAUDIO || pkt->content == cStreamInfo::scVIDEO);
+
+  // wait for AV frames (we start with an audio or video packet)
+  if (IsStarting())
+  {
+    if(!av) {
+      return;
+    }
+
+    INFOLOG("streaming of channel started");
+    m_startup = false;
+
+    // stream change has already been sent from the cache (warm start)
+    if(!m_warmStart) {
+      m_requestStreamChange = true;
+    }
+  }
+
+  // if a audio or video packet was received, the signal is restored
+  if(m_SignalLost && av) {
+    INFOLOG("signal restored");
+    m_SignalLost = false;
+  }
+
+  m_last_tick.Set(0);
+
+  // store changed stream information and notify all clients
+  bool streamChange = m_requestStreamChange;
+
+  if(streamChange) {
+    storeStreamInfo();
+    m_requestStreamChange = false;
+  }
+
+  // the frame data is shared by all clients
+  MsgPayload* payload = MsgPayload::create(pkt->size);
+
+  if(payload == NULL) {
+    return;
+  }
+
+  memcpy(payload->data(), pkt->data, pkt->size);
+
+  {
+    cMutexLock lock(&m_StreamerMutex);
+    for (std::list<cLiveStreamer*>::iterator i = m_Streamers.begin(); i != m_Streamers.end(); i++) {
+      if(streamChange) {
+        (*i)->RequestStreamChange();
+      }
+      if((*i)->m_replayCache) {
+        replayCache(*i);
+      }
+      (*i)->sendStreamPacket(pkt, payload);
+    }
+  }
+
+  cachePacket(pkt, payload);
+  payload->unref();
+}
+
+void cLiveReceiver::GetStreamingModes(bool& parse, bool& raw)
+{
+  cMutexLock lock(&m_StreamerMutex);
+
+  int rawcount = 0;
+  for (std::list<cLiveStreamer*>::iterator i = m_Streamers.begin(); i != m_Streamers.end(); i++) {
+    if((*i)->m_rawTS) {
+      rawcount++;
+    }
+  }
+
+  raw = (rawcount > 0);
+  parse = (rawcount < (int)m_Streamers.size());
+}
+
+void cLiveReceiver::sendRawTS(uchar* data, int length, bool parse)
+{
+  bool streamChange = false;
+
+  // without parsing the raw stream drives startup and signal detection
+  if(!parse) {
+    if (IsStarting()) {
+      INFOLOG("streaming of channel started (raw TS)");
+      m_startup = false;
+    }
+
+    if(m_SignalLost) {
+      INFOLOG("signal restored");
+      m_SignalLost = false;
+    }
+
+    m_last_tick.Set(0);
+
+    streamChange = m_requestStreamChange;
+    m_requestStreamChange = false;
+  }
+
+  cMutexLock lock(&m_StreamerMutex);
+  for (std::list<cLiveStreamer*>::iterator i = m_Streamers.begin(); i != m_Streamers.end(); i++) {
+    if(!(*i)->m_rawTS) {
+      continue;
+    }
+    if(streamChange) {
+      (*i)->RequestStreamChange();
+    }
+    (*i)->sendRawTS(data, length);
+  }
+}
+
+void cLiveReceiver::cachePacket(sStreamPacket *pkt, MsgPayload* payload)
+{
+  if(m_CacheSize == 0) {
+    return;
+  }
+
+  // a new GOP starts with a video I-frame
+  if(pkt->content == cStreamInfo::scVIDEO && pkt->frametype == cStreamInfo::ftIFRAME) {
+    clearCache();
+  }
+  // no GOP start seen yet
+  else if(m_Cache.empty()) {
+    return;
+  }
+
+  // GOP too large -> wait for the next one
+  if(m_CacheBytes + pkt->size > m_CacheSize) {
+    clearCache();
+    return;
+  }
+
+  sCachedPacket p;
+  p.pkt = *pkt;
+  p.payload = payload->ref();
+  p.pkt.data = payload->data();
+
+  m_Cache.push_back(p);
+  m_CacheBytes += pkt->size;
+}
+
+void cLiveReceiver::clearCache()
+{
+  for(std::deque<sCachedPacket>::iterator i = m_Cache.begin(); i != m_Cache.end(); i++) {
+    i->payload->unref();
+  }
+
+  m_Cache.clear();
+  m_CacheBytes = 0;
+}
+
+void cLiveReceiver::replayCache(cLiveStreamer* streamer)
+{
+  streamer->m_replayCache = false;
+
+  if(m_Cache.empty()) {
+    return;
+  }
+
+  DEBUGLOG("sending cached GOP (%u packets, %u bytes)", (uint32_t)m_Cache.size(), m_CacheBytes);
+
+  // cached packets keep their original (continuous) timestamps, the
+  // whole GOP is queued at once (exempt from the drop policy)
+  streamer->m_Queue->SetBurst(true);
+
+  for(std::deque<sCachedPacket>::iterator i = m_Cache.begin(); i != m_Cache.end(); i++) {
+    streamer->sendStreamPacket(&i->pkt, i->payload);
+  }
+
+  streamer->m_Queue->SetBurst(false);
+}
+
+void cLiveReceiver::storeStreamInfo()
+{
+  // keep streams not demuxed for any client
+  cChannelCache cache = cChannelCache::GetFromCache(m_uid);
+  INFOLOG("Stored channel information in cache:");
+  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++) {
+    cache.AddStream(*(*i));
+    (*i)->info();
+  }
+  cChannelCache::AddToCache(m_uid, cache);
+}
+
+void cLiveReceiver::sendStatus(int status)
+{
+  cMutexLock lock(&m_StreamerMutex);
+  for (std::list<cLiveStreamer*>::iterator i = m_Streamers.begin(); i != m_Streamers.end(); i++) {
+    (*i)->sendStatus(status);
+  }
+}
+
+void cLiveReceiver::sendStatusMessage(const char* Message)
+{
+  cMutexLock lock(&m_StreamerMutex);
+  for (std::list<cLiveStreamer*>::iterator i = m_Streamers.begin(); i != m_Streamers.end(); i++) {
+    (*i)->sendStatusMessage(Message);
+  }
+}
+
+bool cLiveReceiver::IsReady()
+{
+  if(m_ready)
+    return true;
+
+  cMutexLock lock(&m_FilterMutex);
+
+  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
+  {
+    if (!(*i)->IsParsed()) {
+      DEBUGLOG("Stream with PID %i not parsed", (*i)->GetPID());
+      return false;
+    }
+  }
+
+  m_ready = true;
+  return true;
+}
+
+void cLiveReceiver::Receive(uchar *Data, int Length)
+{
+  int p = Put(Data, Length);
+
+  if (p != Length)
+    ReportOverflow(Length - p);
+}
+
+void cLiveReceiver::ChannelChange(const cChannel* channel) {
+  cMutexLock lock(&m_FilterMutex);
+
+  if(CreateChannelUID(channel) != m_uid || !Running()) {
+    return;
+  }
+
+  INFOLOG("ChannelChange()");
+
+  SwitchChannel(channel);
+}
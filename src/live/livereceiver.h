@@ -0,0 +1,155 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2010 Alwin Esch (Team XBMC)
+ *      Copyright (C) 2010, 2011 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_LIVERECEIVER_H
+#define XVDR_LIVERECEIVER_H
+
+#include <vdr/channels.h>
+#include <vdr/device.h>
+#include <vdr/receiver.h>
+#include <vdr/thread.h>
+#include <vdr/ringbuffer.h>
+#include <vdr/status.h>
+
+#include "demuxer/demuxer.h"
+
+#include <list>
+#include <deque>
+#include <set>
+
+class cChannel;
+class cTSDemuxer;
+class cLivePatFilter;
+class cLiveStreamer;
+class MsgPayload;
+
+// Demux session of a channel.
+// The receiver is shared by all clients streaming the same channel.
+// Each frame is demuxed once and handed to the cLiveStreamer of every
+// subscribed client.
+
+class cLiveReceiver : public cThread
+                    , public cRingBufferLinear
+                    , public cReceiver
+                    , public cStatus
+{
+private:
+  friend class cTSDemuxer;
+  friend class cLivePatFilter;
+  friend class cChannelCache;
+  friend class cLiveStreamer;
+
+  enum { PidTableSize = 0x2000 };                   /*!> 13 bit PID range */
+
+  cLiveReceiver(const cChannel *channel, int priority);
+  virtual ~cLiveReceiver();
+
+  void Detach(void);
+  bool Attach(void);
+  cTSDemuxer *FindStreamDemuxer(int Pid) { return m_PidTable[Pid & (PidTableSize - 1)]; }
+  void UpdatePidTable();
+
+  void sendStreamPacket(sStreamPacket *pkt);
+  void sendRawTS(uchar* data, int length, bool parse);
+  void GetStreamingModes(bool& parse, bool& raw);
+  void sendStatus(int status);
+  void sendStatusMessage(const char* Message);
+  void storeStreamInfo();
+
+  void cachePacket(sStreamPacket *pkt, MsgPayload* payload);
+  void clearCache();
+  void replayCache(cLiveStreamer* streamer);
+
+  void AddStreamer(cLiveStreamer* streamer);
+  int RemoveStreamer(cLiveStreamer* streamer);
+  void Retune(const cChannel *channel);
+  bool IsSelected(const cStreamInfo& info);
+  void UpdateDemuxers();
+
+  cDevice          *m_Device;                       /*!> The receiving device the channel depents to */
+  cLivePatFilter   *m_PatFilter;                    /*!> Filter processor to get changed pid's */
+  std::list<cTSDemuxer*> m_Demuxers;
+  cTSDemuxer       *m_PidTable[PidTableSize];              /*!> PID -> demuxer lookup (must match m_Demuxers) */
+  std::list<cLiveStreamer*> m_Streamers;            /*!> Subscribed clients */
+  bool              m_startup;
+  bool              m_requestStreamChange;
+  uint32_t          m_scanTimeout;                  /*!> Channel scanning timeout (in seconds) */
+  cTimeMs           m_last_tick;
+  bool              m_SignalLost;
+  cMutex            m_FilterMutex;
+  cMutex            m_DeviceMutex;
+  cMutex            m_StreamerMutex;
+  uint32_t          m_uid;
+  int               m_priority;
+  volatile int      m_generation;                   /*!> Incremented whenever buffered data gets stale */
+  bool              m_ready;
+  bool              m_warmStart;                    /*!> Stream information has been sent from cache */
+  bool              m_warmPending;                  /*!> Cached stream information waits for the PMT */
+
+  // most recent GOP (starting with an I-frame) for clients joining the session
+  struct sCachedPacket {
+    sStreamPacket   pkt;
+    MsgPayload*     payload;
+  };
+
+  std::deque<sCachedPacket> m_Cache;
+  uint32_t          m_CacheBytes;
+
+  static uint32_t   m_CacheSize;
+
+  static std::list<cLiveReceiver*> m_Receivers;
+  static cMutex     m_ReceiversMutex;
+
+protected:
+  void Action(void);
+  void Receive(uchar *Data, int Length);
+
+  void RequestStreamChange();
+
+  void ConfirmStreams();
+
+  int SwitchChannel(const cChannel *channel);
+
+  virtual void ChannelChange(const cChannel *Channel);
+
+private:
+
+  void TryChannelSwitch();
+
+public:
+
+  static cLiveReceiver* Subscribe(cLiveStreamer* streamer, const cChannel *channel, int priority);
+  static void Unsubscribe(cLiveReceiver* receiver, cLiveStreamer* streamer);
+  static cLiveReceiver* Retune(cLiveReceiver* receiver, cLiveStreamer* streamer, const cChannel *channel, int priority);
+
+  bool IsReady();
+  bool IsStarting() { return m_startup; }
+
+  void SetTimeout(uint32_t timeout);
+
+  static void SetGOPCacheSize(uint32_t size);
+};
+
+#endif  // XVDR_LIVERECEIVER_H
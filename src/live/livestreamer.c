@@ -46,41 +46,34 @@
 #include "tools/hash.h"
 
 #include "livestreamer.h"
+#include "livereceiver.h"
 #include "livepatfilter.h"
 #include "livequeue.h"
 #include "channelcache.h"
 
 cLiveStreamer::cLiveStreamer(cXVDRClient* parent, const cChannel *channel, int priority)
- : cThread("cLiveStreamer stream processor")
- , cRingBufferLinear(MEGABYTE(10), TS_SIZE * 2, true)
- , cReceiver(NULL, priority)
- , m_scanTimeout(10)
- , m_parent(parent)
+ : m_parent(parent)
 {
-  m_Device          = NULL;
+  m_Receiver        = NULL;
   m_Queue           = NULL;
   m_startup         = true;
   m_SignalLost      = false;
   m_LangStreamType  = cStreamInfo::stMPEG2AUDIO;
   m_LanguageIndex   = -1;
   m_uid             = CreateChannelUID(channel);
-  m_ready           = false;
   m_protocolVersion = XVDR_PROTOCOLVERSION;
   m_waitforiframe   = false;
-  m_PatFilter       = NULL;
-
+  m_replayCache     = false;
+  m_streamChangeSent = false;
+  m_rawTS           = false;
 
   m_requestStreamChange = false;
 
-  if(m_scanTimeout == 0)
-    m_scanTimeout = XVDRServerConfig.stream_timeout;
-
   // create send queue
-  m_Queue = new cLiveQueue(m_parent->GetSocket());
-  m_Queue->Start();
+  m_Queue = new cLiveQueue(m_parent->GetSocket(), m_parent->GetWriter());
 
-  SetTimeouts(0, 10);
-  Start();
+  // join (or start) the demux session of the channel
+  m_Receiver = cLiveReceiver::Subscribe(this, channel, priority);
 }
 
 cLiveStreamer::~cLiveStreamer()
@@ -89,349 +82,128 @@ cLiveStreamer::~cLiveStreamer()
 
   cTimeMs t;
 
-  DEBUGLOG("Stopping streamer thread ...");
-  Cancel(5);
-  DEBUGLOG("Done.");
-
-  cMutexLock lock(&m_FilterMutex);
-
-  DEBUGLOG("Detaching");
-
-  if(m_PatFilter != NULL && m_Device != NULL) {
-    m_Device->Detach(m_PatFilter);
-    delete m_PatFilter;
-    m_PatFilter = NULL;
-  }
-
-  if (IsAttached()) {
-    Detach();
-  }
-
-  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++) {
-    if ((*i) != NULL) {
-      DEBUGLOG("Deleting stream demuxer for pid=%i and type=%i", (*i)->GetPID(), (*i)->GetType());
-      delete (*i);
-    }
-  }
-  m_Demuxers.clear();
+  cLiveReceiver::Unsubscribe(m_Receiver, this);
+  m_Receiver = NULL;
 
   delete m_Queue;
 
   m_uid = 0;
 
-  {
-    cMutexLock lock(&m_DeviceMutex);
-    m_Device = NULL;
-  }
-
   DEBUGLOG("Finished to delete live streamer (took %llu ms)", t.Elapsed());
 }
 
-void cLiveStreamer::SetTimeout(uint32_t timeout) {
-  m_scanTimeout = timeout;
-}
-
-void cLiveStreamer::SetProtocolVersion(uint32_t protocolVersion) {
-  m_protocolVersion = protocolVersion;
-}
-
-void cLiveStreamer::SetWaitForIFrame(bool waitforiframe) {
-  m_waitforiframe = waitforiframe;
-}
-
-void cLiveStreamer::RequestStreamChange()
+void cLiveStreamer::Retune(const cChannel *channel, int priority)
 {
-  m_requestStreamChange = true;
-}
-
-void cLiveStreamer::TryChannelSwitch() {
-  // find channel from uid
-  const cChannel* channel = FindChannelByUID(m_uid);
-
-  // try to switch channel
-  int rc = SwitchChannel(channel);
-
-  // succeeded -> exit
-  if(rc == XVDR_RET_OK) {
-    return;
-  }
+  cTimeMs t;
 
-  // time limit not exceeded -> relax & exit
-  if(m_last_tick.Elapsed() < (uint64_t)(m_scanTimeout*1000)) {
-    cCondWait::SleepMs(10);
-    return;
-  }
+  m_Receiver = cLiveReceiver::Retune(m_Receiver, this, channel, priority);
 
-  // push notification after timeout
-  switch(rc) {
-    case XVDR_RET_ENCRYPTED:
-      ERRORLOG("Unable to decrypt channel %i - %s", channel->Number(), channel->Name());
-      m_parent->StatusMessage(tr("Unable to decrypt channel"));
-      break;
-    case XVDR_RET_DATALOCKED:
-      ERRORLOG("Can't get device for channel %i - %s", channel->Number(), channel->Name());
-      m_parent->StatusMessage(tr("All tuners busy"));
-      break;
-    case XVDR_RET_RECRUNNING:
-      ERRORLOG("Active recording blocking channel %i - %s", channel->Number(), channel->Name());
-      m_parent->StatusMessage(tr("Blocked by active recording"));
-      break;
-    case XVDR_RET_ERROR:
-      ERRORLOG("Error switching to channel %i - %s", channel->Number(), channel->Name());
-      m_parent->StatusMessage(tr("Failed to switch"));
-      break;
-  }
+  // timeshift buffer of the previous channel (not deleted under the receiver locks)
+  m_Queue->ReleaseTimeShift();
 
-  m_last_tick.Set(0);
+  DEBUGLOG("Retuned live streamer (took %llu ms)", t.Elapsed());
 }
 
-void cLiveStreamer::Action(void)
+void cLiveStreamer::Reset(const cChannel *channel)
 {
-  int size = 0;
-  unsigned char *buf = NULL;
-  m_startup = true;
-
-  // reset timer
-  m_last_tick.Set(0);
-
-  INFOLOG("streamer thread started.");
-
-  while (Running())
-  {
-    size = 0;
-    buf = Get(size);
-
-    // try to switch channel if we aren't attached yet
-    {
-      cMutexLock lock(&m_FilterMutex);
-      if (!IsAttached()) {
-        TryChannelSwitch();
-      }
-    }
-
-    if(!IsStarting() && (m_last_tick.Elapsed() > (uint64_t)(m_scanTimeout*1000)) && !m_SignalLost)
-    {
-      INFOLOG("timeout. signal lost!");
-      sendStatus(XVDR_STREAM_STATUS_SIGNALLOST);
-      m_SignalLost = true;
-
-      // retune to restore
-      cMutexLock lock(&m_FilterMutex);
-      if(m_PatFilter != NULL && m_Device != NULL) {
-        m_Device->Detach(m_PatFilter);
-        delete m_PatFilter;
-        m_PatFilter = NULL;
-      }
-
-      if(IsAttached()) {
-        Detach();
-      }
-    }
-
-    // no data
-    if (buf == NULL || size <= TS_SIZE)
-      continue;
-
-    // Sync to TS packet
-    int used = 0;
-    while (size > TS_SIZE)
-    {
-      if (buf[0] == TS_SYNC_BYTE && buf[TS_SIZE] == TS_SYNC_BYTE)
-        break;
-      used++;
-      buf++;
-      size--;
-    }
-    Del(used);
+  // drop everything queued (or time-shifted) for the previous channel
+  m_Queue->Reset();
 
-    while (size >= TS_SIZE)
-    {
-      if(!Running())
-        break;
-
-      // TS packet sync not found !
-      if (buf[0] != TS_SYNC_BYTE)
-        break;
-
-      unsigned int ts_pid = TsPid(buf);
-
-      {
-        cMutexLock lock(&m_FilterMutex);
-        cTSDemuxer *demuxer = FindStreamDemuxer(ts_pid);
-
-        if (demuxer)
-          demuxer->ProcessTSPacket(buf);
-      }
-
-      buf += TS_SIZE;
-      size -= TS_SIZE;
-      Del(TS_SIZE);
-    }
-  }
+  m_uid                 = CreateChannelUID(channel);
+  m_startup             = true;
+  m_SignalLost          = false;
+  m_requestStreamChange = false;
+  m_streamChangeSent    = false;
+  m_replayCache         = false;
 
-  INFOLOG("streamer thread ended.");
+  // PIDs are specific to the channel, stream types apply to all channels
+  m_SelectedPids.clear();
 }
 
-int cLiveStreamer::SwitchChannel(const cChannel *channel)
+bool cLiveStreamer::IsSelected(int pid, cStreamInfo::Type type)
 {
-  if (channel == NULL) {
-    return XVDR_RET_ERROR;
-  }
-
-  if(m_PatFilter != NULL && m_Device != NULL) {
-    m_Device->Detach(m_PatFilter);
-    delete m_PatFilter;
-    m_PatFilter = NULL;
-  }
-
-  if(IsAttached()) {
-    Detach();
-  }
-
-  // check if any device is able to decrypt the channel - code taken from VDR
-  int NumUsableSlots = 0;
-
-  if (channel->Ca() >= CA_ENCRYPTED_MIN) {
-    for (cCamSlot *CamSlot = CamSlots.First(); CamSlot; CamSlot = CamSlots.Next(CamSlot)) {
-      if (CamSlot->ModuleStatus() == msReady) {
-        if (CamSlot->ProvidesCa(channel->Caids())) {
-          if (!ChannelCamRelations.CamChecked(channel->GetChannelID(), CamSlot->SlotNumber())) {
-            NumUsableSlots++;
-          }
-       }
-      }
-    }
-    if (!NumUsableSlots) {
-      return XVDR_RET_ENCRYPTED;
-    }
-  }
-
-  // get device for this channel
-  {
-    cMutexLock lock(&m_DeviceMutex);
-    m_Device = cDevice::GetDevice(channel, LIVEPRIORITY, false);
-  }
-
-  if (m_Device == NULL)
-  {
-    // return status "recording running" if there is an active timer
-    time_t now = time(NULL);
-
-    for (cTimer *ti = Timers.First(); ti; ti = Timers.Next(ti)) {
-      if (ti->Recording() && ti->Matches(now)) {
-        return XVDR_RET_RECRUNNING;
-      }
-    }
-
-    return XVDR_RET_DATALOCKED;
+  if(m_SelectedPids.empty() && m_SelectedTypes.empty()) {
+    return true;
   }
 
-  INFOLOG("Found available device %d", m_Device->DeviceNumber() + 1);
+  return (m_SelectedPids.find(pid) != m_SelectedPids.end() || m_SelectedTypes.find(type) != m_SelectedTypes.end());
+}
 
-  if (!m_Device->SwitchChannel(channel, false))
+void cLiveStreamer::Select(const std::set<int>& pids, const std::set<int>& types)
+{
   {
-    ERRORLOG("Can't switch to channel %i - %s", channel->Number(), channel->Name());
-    return XVDR_RET_ERROR;
+    cMutexLock lock(&m_Receiver->m_FilterMutex);
+    m_SelectedPids = pids;
+    m_SelectedTypes = types;
   }
 
-  // get cached demuxer data
-  cChannelCache cache = cChannelCache::GetFromCache(m_uid);
-
-  // channel already in cache
-  if(cache.size() != 0) {
-    INFOLOG("Channel information found in cache");
-  }
-  // channel not found in cache -> add it from vdr
-  else {
-    INFOLOG("adding channel to cache");
-    cChannelCache::AddToCache(channel);
-    cache = cChannelCache::GetFromCache(m_uid);
-  }
+  INFOLOG("Stream selection changed (%i pids, %i types)", (int)pids.size(), (int)types.size());
 
-  // recheck cache item
-  cChannelCache currentitem = cChannelCache::ItemFromChannel(channel);
-  if(!currentitem.ismetaof(cache)) {
-    INFOLOG("current channel differs from cache item - updating");
-    cache = currentitem;
-    cChannelCache::AddToCache(m_uid, cache);
-  }
+  // demux the streams of all clients and inform this one
+  m_Receiver->UpdateDemuxers();
+  RequestStreamChange();
+}
 
-  if(cache.size() != 0) {
-    INFOLOG("Creating demuxers");
-    cache.CreateDemuxers(this);
-  }
+void cLiveStreamer::SetTimeout(uint32_t timeout) {
+  m_Receiver->SetTimeout(timeout);
+}
 
-  RequestStreamChange();
+void cLiveStreamer::SetProtocolVersion(uint32_t protocolVersion) {
+  m_protocolVersion = protocolVersion;
+}
 
-  INFOLOG("Successfully switched to channel %i - %s", channel->Number(), channel->Name());
+void cLiveStreamer::SetWaitForIFrame(bool waitforiframe) {
+  m_waitforiframe = waitforiframe;
 
   if(m_waitforiframe) {
     INFOLOG("Will wait for first I-Frame ...");
   }
+}
 
-  // clear cached data
-  Clear();
-  m_Queue->Cleanup();
-
-  m_uid = CreateChannelUID(channel);
+void cLiveStreamer::SetRawTS(bool rawts) {
+  cMutexLock lock(&m_Receiver->m_FilterMutex);
+  m_rawTS = rawts;
 
-  if(!Attach()) {
-    INFOLOG("Unable to attach receiver !");
-    return XVDR_RET_DATALOCKED;
+  // the stream change may have been sent before (warm start),
+  // so PAT / PMT have to be set up here
+  if(m_rawTS) {
+    INFOLOG("Sending raw transport stream");
+    UpdatePatPmt();
   }
-
-  INFOLOG("Starting PAT scanner");
-  m_PatFilter = new cLivePatFilter(this);
-  m_PatFilter->SetChannel(channel);
-  m_Device->AttachFilter(m_PatFilter);
-
-  INFOLOG("done switching.");
-  return XVDR_RET_OK;
 }
 
-cTSDemuxer *cLiveStreamer::FindStreamDemuxer(int Pid)
+void cLiveStreamer::RequestStreamChange()
 {
-  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
-    if ((*i) != NULL && (*i)->GetPID() == Pid)
-      return (*i);
-
-  return NULL;
+  m_requestStreamChange = true;
 }
 
-bool cLiveStreamer::Attach(void)
+void cLiveStreamer::Cleanup()
 {
-  if (m_Device == NULL) {
-    return false;
-  }
-
-  return m_Device->AttachReceiver(this);
+  m_Queue->Cleanup();
 }
 
-void cLiveStreamer::Detach(void)
+void cLiveStreamer::sendStreamPacket(sStreamPacket *pkt, MsgPayload* payload)
 {
-  if (m_Device) {
-    m_Device->Detach(this);
+  // stream not subscribed by this client (or raw TS is sent)
+  if(m_rawTS || !IsSelected(pkt->pid, pkt->type)) {
+    return;
   }
-}
-
-void cLiveStreamer::sendStreamPacket(sStreamPacket *pkt)
-{
-  bool bReady = IsReady();
 
-  if(!bReady || pkt == NULL || pkt->size == 0)
-    return;
+  bool av = (pkt->content == cStreamInfo::scAUDIO || pkt->content == cStreamInfo::scVIDEO);
 
   // Send stream information as the first packet on startup
-  if (IsStarting() && bReady)
+  if (IsStarting())
   {
     // wait for AV frames (we start with an audio or video packet)
-    if(!(pkt->content == cStreamInfo::scAUDIO || pkt->content == cStreamInfo::scVIDEO)) {
+    if(!av) {
       return;
     }
 
-    INFOLOG("streaming of channel started");
-    m_last_tick.Set(0);
-    m_requestStreamChange = true;
+    // stream information may already be known from the cache
+    if(!m_streamChangeSent) {
+      m_requestStreamChange = true;
+    }
+
     m_startup = false;
   }
 
@@ -447,12 +219,10 @@ void cLiveStreamer::sendStreamPacket(sStreamPacket *pkt)
   m_waitforiframe = false;
 
   // if a audio or video packet was sent, the signal is restored
-  if(m_SignalLost && (pkt->content == cStreamInfo::scVIDEO || pkt->content == cStreamInfo::scAUDIO)) {
-    INFOLOG("signal restored");
+  if(m_SignalLost && av) {
     sendStatus(XVDR_STREAM_STATUS_SIGNALRESTORED);
     m_SignalLost = false;
     m_requestStreamChange = true;
-    m_last_tick.Set(0);
     return;
   }
 
@@ -474,12 +244,111 @@ void cLiveStreamer::sendStreamPacket(sStreamPacket *pkt)
   // write frame type into unused header field clientid
   packet->setClientID((uint16_t)pkt->frametype);
 
-  // write payload into stream packet
+  // attach the shared payload to stream packet (sent with the header in one go)
   packet->put_U32(pkt->size);
-  packet->put_Blob(pkt->data, pkt->size);
+  packet->attach(payload);
+
+  m_Queue->Add(packet, pkt->content, pkt->frametype, pkt->pts);
+}
+
+static uchar* NextTSPacket(uchar* data, int length, int& pos)
+{
+  while(length - pos >= TS_SIZE) {
+    uchar* p = data + pos;
+
+    // TS packet sync lost -> skip to the next sync byte
+    if(p[0] != TS_SYNC_BYTE) {
+      uchar* sync = (uchar*)memchr(p + 1, TS_SYNC_BYTE, length - pos - 1);
+      pos = (sync == NULL) ? length : (sync - data);
+      continue;
+    }
+
+    pos += TS_SIZE;
+    return p;
+  }
+
+  return NULL;
+}
+
+void cLiveStreamer::sendRawTS(uchar* data, int length)
+{
+  // Send stream information as the first packet on startup
+  if(IsStarting()) {
+    if(!m_streamChangeSent) {
+      m_requestStreamChange = true;
+    }
+    m_startup = false;
+  }
+
+  if(m_SignalLost) {
+    sendStatus(XVDR_STREAM_STATUS_SIGNALRESTORED);
+    m_SignalLost = false;
+    m_requestStreamChange = true;
+  }
+
+  // send stream change (and update PAT / PMT) on demand
+  if(m_requestStreamChange)
+    sendStreamChange();
+
+  // count packets of the subscribed streams
+  int pos = 0;
+  int count = 0;
+  uchar* p = NULL;
+
+  while((p = NextTSPacket(data, length, pos)) != NULL) {
+    int pid = TsPid(p);
+    cTSDemuxer* demuxer = m_Receiver->FindStreamDemuxer(pid);
+
+    if(demuxer != NULL && IsSelected(pid, demuxer->GetType()))
+      count++;
+  }
+
+  if(count == 0)
+    return;
+
+  // repeat PAT / PMT every 100 ms (as soon as the streams are known)
+  uchar patpmt[2 * TS_SIZE];
+  int patpmtsize = 0;
+
+  if(m_PatPmtTimer.TimedOut()) {
+    patpmtsize = m_PatPmt.Put(patpmt);
+
+    if(patpmtsize > 0)
+      m_PatPmtTimer.Set(100);
+  }
+
+  int size = count * TS_SIZE + patpmtsize;
+
+  MsgPacket* packet = new MsgPacket(XVDR_STREAM_TSPACKETS, XVDR_CHANNEL_STREAM);
+  packet->disablePayloadCheckSum();
+  packet->put_U32(size);
+
+  // copy all TS packets in one go
+  uchar* out = packet->reserve(size);
 
-  m_Queue->Add(packet, pkt->content);
-  m_last_tick.Set(0);
+  if(out == NULL) {
+    delete packet;
+    return;
+  }
+
+  if(patpmtsize > 0) {
+    memcpy(out, patpmt, patpmtsize);
+    out += patpmtsize;
+  }
+
+  pos = 0;
+
+  while((p = NextTSPacket(data, length, pos)) != NULL) {
+    int pid = TsPid(p);
+    cTSDemuxer* demuxer = m_Receiver->FindStreamDemuxer(pid);
+
+    if(demuxer != NULL && IsSelected(pid, demuxer->GetType())) {
+      memcpy(out, p, TS_SIZE);
+      out += TS_SIZE;
+    }
+  }
+
+  m_Queue->Add(packet, cStreamInfo::scRAWTS);
 }
 
 void cLiveStreamer::sendDetach() {
@@ -494,24 +363,17 @@ void cLiveStreamer::sendStreamChange()
 
   DEBUGLOG("sendStreamChange");
 
-  cChannelCache cache;
-  INFOLOG("Stored channel information in cache:");
-  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++) {
-    cache.AddStream(*(*i));
-    (*i)->info();
-  }
-  cChannelCache::AddToCache(m_uid, cache);
+  cMutexLock lock(&m_Receiver->m_FilterMutex);
 
-  m_FilterMutex.Lock();
+  // order streams as preferred by this client
+  std::list<cTSDemuxer*> streams = m_Receiver->m_Demuxers;
+  reorderStreams(streams, m_LanguageIndex, m_LangStreamType);
 
-  // reorder streams as preferred
-  reorderStreams(m_LanguageIndex, m_LangStreamType);
-
-  for (std::list<cTSDemuxer*>::iterator idx = m_Demuxers.begin(); idx != m_Demuxers.end(); idx++)
+  for (std::list<cTSDemuxer*>::iterator idx = streams.begin(); idx != streams.end(); idx++)
   {
     cTSDemuxer* stream = (*idx);
 
-    if (stream == NULL)
+    if (stream == NULL || !IsSelected(stream->GetPID(), stream->GetType()))
       continue;
 
     int streamid = stream->GetPID();
@@ -556,10 +418,32 @@ void cLiveStreamer::sendStreamChange()
     }
   }
 
-  m_FilterMutex.Unlock();
-
   m_Queue->Add(resp, cStreamInfo::scSTREAMINFO);
   m_requestStreamChange = false;
+  m_streamChangeSent = true;
+
+  // describe the sent streams in the raw transport stream
+  if(m_rawTS) {
+    UpdatePatPmt();
+  }
+}
+
+void cLiveStreamer::UpdatePatPmt()
+{
+  cMutexLock lock(&m_Receiver->m_FilterMutex);
+
+  std::list<cTSDemuxer*> streams = m_Receiver->m_Demuxers;
+  std::list<cTSDemuxer*> selected;
+  reorderStreams(streams, m_LanguageIndex, m_LangStreamType);
+
+  for (std::list<cTSDemuxer*>::iterator i = streams.begin(); i != streams.end(); i++) {
+    if ((*i) != NULL && IsSelected((*i)->GetPID(), (*i)->GetType()))
+      selected.push_back(*i);
+  }
+
+  const cChannel* channel = FindChannelByUID(m_uid);
+  m_PatPmt.SetStreams(channel ? channel->Sid() : 1, channel ? channel->Tid() : 1, selected);
+  m_PatPmtTimer.Set(0);
 }
 
 void cLiveStreamer::sendStatus(int status)
@@ -567,13 +451,24 @@ void cLiveStreamer::sendStatus(int status)
   MsgPacket* packet = new MsgPacket(XVDR_STREAM_STATUS, XVDR_CHANNEL_STREAM);
   packet->put_U32(status);
   m_parent->QueueMessage(packet);
+
+  if(status == XVDR_STREAM_STATUS_SIGNALLOST) {
+    m_SignalLost = true;
+  }
+}
+
+void cLiveStreamer::sendStatusMessage(const char* Message)
+{
+  m_parent->StatusMessage(Message);
 }
 
+
 void cLiveStreamer::RequestSignalInfo()
 {
-  cMutexLock lock(&m_DeviceMutex);
+  cMutexLock lock(&m_Receiver->m_DeviceMutex);
+  cDevice* device = m_Receiver->m_Device;
 
-  if(!Running() || m_Device == NULL) {
+  if(!m_Receiver->Active() || device == NULL) {
     return;
   }
 
@@ -584,13 +479,13 @@ void cLiveStreamer::RequestSignalInfo()
 
   MsgPacket* resp = new MsgPacket(XVDR_STREAM_SIGNALINFO, XVDR_CHANNEL_STREAM);
 
-  int DeviceNumber = m_Device->DeviceNumber() + 1;
+  int DeviceNumber = device->DeviceNumber() + 1;
   int Strength = 0;
   int Quality = 0;
 
   if(!TimeShiftMode()) {
-    Strength = m_Device->SignalStrength();
-    Quality = m_Device->SignalQuality();
+    Strength = device->SignalStrength();
+    Quality = device->SignalQuality();
   }
 
   resp->put_String(*cString::sprintf("%s #%d - %s", 
@@ -600,9 +495,9 @@ void cLiveStreamer::RequestSignalInfo()
 			DeviceNumber,
 			"Unknown"));
 #else
-			(const char*)m_Device->DeviceType(),
+			(const char*)device->DeviceType(),
 			DeviceNumber,
-			(const char*)m_Device->DeviceName()));
+			(const char*)device->DeviceName()));
 #endif
 
   // Quality:
@@ -653,13 +548,13 @@ void cLiveStreamer::RequestSignalInfo()
   m_Queue->Add(resp, cStreamInfo::scNONE);
 }
 
-void cLiveStreamer::reorderStreams(int lang, cStreamInfo::Type type)
+void cLiveStreamer::reorderStreams(std::list<cTSDemuxer*>& streams, int lang, cStreamInfo::Type type)
 {
   std::map<uint32_t, cTSDemuxer*> weight;
 
   // compute weights
   int i = 0;
-  for (std::list<cTSDemuxer*>::iterator idx = m_Demuxers.begin(); idx != m_Demuxers.end(); idx++, i++)
+  for (std::list<cTSDemuxer*>::iterator idx = streams.begin(); idx != streams.end(); idx++, i++)
   {
     cTSDemuxer* stream = (*idx);
     if (stream == NULL)
@@ -721,12 +616,12 @@ void cLiveStreamer::reorderStreams(int lang, cStreamInfo::Type type)
 
   // reorder streams on weight
   int idx = 0;
-  m_Demuxers.clear();
+  streams.clear();
   for(std::map<uint32_t, cTSDemuxer*>::reverse_iterator i = weight.rbegin(); i != weight.rend(); i++, idx++)
   {
     cTSDemuxer* stream = i->second;
     DEBUGLOG("Stream : Type %s / %s Weight: %08X", stream->TypeName(), stream->GetLanguage(), i->first);
-    m_Demuxers.push_back(stream);
+    streams.push_back(stream);
   }
 }
 
@@ -739,25 +634,6 @@ void cLiveStreamer::SetLanguage(int lang, cStreamInfo::Type streamtype)
   m_LangStreamType = streamtype;
 }
 
-bool cLiveStreamer::IsReady()
-{
-  if(m_ready)
-    return true;
-
-  cMutexLock lock(&m_FilterMutex);
-
-  for (std::list<cTSDemuxer*>::iterator i = m_Demuxers.begin(); i != m_Demuxers.end(); i++)
-  {
-    if (!(*i)->IsParsed()) {
-      DEBUGLOG("Stream with PID %i not parsed", (*i)->GetPID());
-      return false;
-    }
-  }
-
-  m_ready = true;
-  return true;
-}
-
 bool cLiveStreamer::IsPaused()
 {
   if(m_Queue == NULL)
@@ -779,32 +655,39 @@ void cLiveStreamer::Pause(bool on) {
     return;
 
   m_Queue->Pause(on);
+
+  // drop a failed timeshift buffer
+  m_Queue->ReleaseTimeShift();
 }
 
-void cLiveStreamer::RequestPacket()
+bool cLiveStreamer::Seek(int64_t pts, bool relative)
 {
   if(m_Queue == NULL)
-    return;
+    return false;
 
-  m_Queue->Request();
+  return m_Queue->Seek(pts, relative);
 }
 
-void cLiveStreamer::Receive(uchar *Data, int Length)
+bool cLiveStreamer::GetTimeShiftRange(int64_t& position, int64_t& start, int64_t& end)
 {
-  int p = Put(Data, Length);
+  if(m_Queue == NULL)
+    return false;
 
-  if (p != Length)
-    ReportOverflow(Length - p);
+  return m_Queue->GetTimeShiftRange(position, start, end);
 }
 
-void cLiveStreamer::ChannelChange(const cChannel* channel) {
-  cMutexLock lock(&m_FilterMutex);
+bool cLiveStreamer::GetTimeShiftStats(uint32_t& staged, uint32_t& stalls)
+{
+  if(m_Queue == NULL)
+    return false;
 
-  if(CreateChannelUID(channel) != m_uid || !Running()) {
-    return;
-  }
+  return m_Queue->GetTimeShiftStats(staged, stalls);
+}
 
-  INFOLOG("ChannelChange()");
+void cLiveStreamer::RequestPacket(uint32_t bytes, uint32_t ms)
+{
+  if(m_Queue == NULL)
+    return;
 
-  SwitchChannel(channel);
+  m_Queue->Request(bytes, ms);
 }
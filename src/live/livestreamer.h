@@ -27,93 +27,86 @@
 #define XVDR_RECEIVER_H
 
 #include <vdr/channels.h>
-#include <vdr/device.h>
-#include <vdr/receiver.h>
 #include <vdr/thread.h>
-#include <vdr/ringbuffer.h>
 
 #include "demuxer/demuxer.h"
 #include "xvdr/xvdrcommand.h"
+#include "livepatpmt.h"
 
 #include <list>
+#include <set>
 
 class cChannel;
 class cTSDemuxer;
 class MsgPacket;
-class cLivePatFilter;
+class MsgPayload;
 class cLiveQueue;
+class cLiveReceiver;
 class cXVDRClient;
 
-class cLiveStreamer : public cThread
-                    , public cRingBufferLinear
-                    , public cReceiver
+class cLiveStreamer
 {
 private:
-  friend class cTSDemuxer;
-  friend class cLivePatFilter;
-  friend class cChannelCache;
+  friend class cLiveReceiver;
 
-  void Detach(void);
-  bool Attach(void);
-  cTSDemuxer *FindStreamDemuxer(int Pid);
+  void reorderStreams(std::list<cTSDemuxer*>& streams, int lang, cStreamInfo::Type type);
 
-  void reorderStreams(int lang, cStreamInfo::Type type);
-
-  void sendStreamPacket(sStreamPacket *pkt);
+  void sendStreamPacket(sStreamPacket *pkt, MsgPayload* payload);
+  void sendRawTS(uchar* data, int length);
   void sendStreamChange();
+  void UpdatePatPmt();
   void sendStatus(int status);
+  void sendStatusMessage(const char* Message);
   void sendDetach();
 
-  cDevice          *m_Device;                       /*!> The receiving device the channel depents to */
-  cLivePatFilter   *m_PatFilter;                    /*!> Filter processor to get changed pid's */
-  std::list<cTSDemuxer*> m_Demuxers;
+  void RequestStreamChange();
+  void Cleanup();
+  void Reset(const cChannel *channel);
+  bool IsSelected(int pid, cStreamInfo::Type type);
+
+  cLiveReceiver    *m_Receiver;                     /*!> Shared demux session of the channel */
   bool              m_startup;
   bool              m_requestStreamChange;
-  uint32_t          m_scanTimeout;                  /*!> Channel scanning timeout (in seconds) */
-  cTimeMs           m_last_tick;
+  bool              m_streamChangeSent;
   bool              m_SignalLost;
-  cMutex            m_FilterMutex;
-  cMutex            m_DeviceMutex;
   int               m_LanguageIndex;
   cStreamInfo::Type m_LangStreamType;
   cLiveQueue*       m_Queue;
   uint32_t          m_uid;
-  bool              m_ready;
   uint32_t          m_protocolVersion;
   bool              m_waitforiframe;
+  bool              m_replayCache;                  /*!> Cached GOP of the receiver is pending */
+  std::set<int>     m_SelectedPids;                 /*!> Subscribed PIDs (all streams if empty) */
+  std::set<int>     m_SelectedTypes;                /*!> Subscribed stream types */
+  bool              m_rawTS;                        /*!> Send the filtered transport stream (no parsing) */
+  cLivePatPmt       m_PatPmt;
+  cTimeMs           m_PatPmtTimer;
   cXVDRClient*      m_parent;
 
-protected:
-  void Action(void);
-  void Receive(uchar *Data, int Length);
-
-  void RequestStreamChange();
-
-  int SwitchChannel(const cChannel *channel);
-
-private:
-
-  void TryChannelSwitch();
-
 public:
   cLiveStreamer(cXVDRClient* parent, const cChannel *channel, int priority);
   virtual ~cLiveStreamer();
 
-  bool IsReady();
   bool IsStarting() { return m_startup; }
   bool IsPaused();
   bool TimeShiftMode();
 
+  void Retune(const cChannel *channel, int priority);
+
   void SetLanguage(int lang, cStreamInfo::Type streamtype = cStreamInfo::stAC3);
   void SetTimeout(uint32_t timeout);
   void SetProtocolVersion(uint32_t protocolVersion);
   void SetWaitForIFrame(bool waitforiframe);
+  void SetRawTS(bool rawts);
+
+  void Select(const std::set<int>& pids, const std::set<int>& types);
 
   void Pause(bool on);
-  void RequestPacket();
+  bool Seek(int64_t pts, bool relative);
+  bool GetTimeShiftRange(int64_t& position, int64_t& start, int64_t& end);
+  bool GetTimeShiftStats(uint32_t& staged, uint32_t& stalls);
+  void RequestPacket(uint32_t bytes = 0, uint32_t ms = 0);
   void RequestSignalInfo();
-
-  void ChannelChange(const cChannel* Channel);
 };
 
 #endif  // XVDR_RECEIVER_H
@@ -0,0 +1,474 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <sys/types.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+
+#include "config/config.h"
+#include "net/msgpacket.h"
+#include "demuxer/demuxer.h"
+#include "xvdr/xvdrwriter.h"
+#include "livetimeshift.h"
+
+cLiveTimeShift::cLiveTimeShift(const cString& dir, int id, uint64_t size, uint64_t memory, cXVDRWriter* writer) : cThread(cString::sprintf("XVDR Timeshift %i", id)), m_dir(dir), m_id(id), m_write(0), m_read(0), m_readIndex(0), m_readIFrame(0), m_position(DVD_NOPTS_VALUE), m_writer(writer)
+{
+  m_staged = 0;
+  m_stagedMax = 0;
+  m_stalls = 0;
+  m_failed = false;
+
+  m_count = (int)(size / SegmentSize);
+
+  // we need at least two segments to recycle
+  if(m_count < 2)
+    m_count = 2;
+
+  // segments held in memory (part of the buffer size)
+  m_memoryCount = std::min((int)(memory / SegmentSize), m_count);
+
+  DEBUGLOG("Timeshift buffer: %i segments of %i bytes (%i in memory)", m_count, SegmentSize, m_memoryCount);
+
+  Start();
+}
+
+cLiveTimeShift::~cLiveTimeShift()
+{
+  Cancel(-1);
+  m_stageCond.Broadcast();
+  Cancel(3);
+
+  while(!m_staging.empty()) {
+    delete m_staging.front().packet;
+    m_staging.pop_front();
+  }
+
+  INFOLOG("Timeshift buffer closed - staged max %u bytes, %u write stalls", m_stagedMax, m_stalls);
+
+  for(std::vector<sSegment>::iterator i = m_segments.begin(); i != m_segments.end(); i++)
+    CloseSegment(*i);
+}
+
+bool cLiveTimeShift::OpenSegment(sSegment& segment, int number)
+{
+  segment.filename = cString::sprintf("%s/xvdr-ringbuffer-%05i-%03i.data", (const char*)m_dir, m_id, number);
+  segment.data = NULL;
+  segment.fd = -1;
+  ClearSegment(segment);
+
+  // memory segment (pages are allocated on first use)
+  if(number < m_memoryCount) {
+    void* data = mmap(NULL, SegmentSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(data == MAP_FAILED) {
+      ERRORLOG("Failed to allocate timeshift segment %i in memory", number);
+      return false;
+    }
+
+    segment.data = (uint8_t*)data;
+    return true;
+  }
+
+  DEBUGLOG("FILE: %s", (const char*)segment.filename);
+
+  segment.fd = open(segment.filename, O_CREAT | O_TRUNC | O_RDWR, 0644);
+
+  if(segment.fd == -1) {
+    ERRORLOG("Failed to create timeshift segment %s", (const char*)segment.filename);
+    return false;
+  }
+
+  // allocate the whole segment in one go (keeps the file contiguous on disk)
+  if(posix_fallocate(segment.fd, 0, SegmentSize) != 0 && ftruncate(segment.fd, SegmentSize) != 0) {
+    ERRORLOG("Failed to allocate timeshift segment %s", (const char*)segment.filename);
+    CloseSegment(segment);
+    return false;
+  }
+
+  void* data = mmap(NULL, SegmentSize, PROT_READ | PROT_WRITE, MAP_SHARED, segment.fd, 0);
+
+  if(data == MAP_FAILED) {
+    ERRORLOG("Failed to map timeshift segment %s", (const char*)segment.filename);
+    CloseSegment(segment);
+    return false;
+  }
+
+  segment.data = (uint8_t*)data;
+  madvise(segment.data, SegmentSize, MADV_SEQUENTIAL);
+
+  return true;
+}
+
+void cLiveTimeShift::CloseSegment(sSegment& segment)
+{
+  if(segment.data != NULL)
+    munmap(segment.data, SegmentSize);
+
+  if(segment.fd != -1) {
+    close(segment.fd);
+    unlink(segment.filename);
+  }
+
+  segment.data = NULL;
+  segment.fd = -1;
+  ClearSegment(segment);
+}
+
+void cLiveTimeShift::ClearSegment(sSegment& segment)
+{
+  segment.used = 0;
+  segment.index.clear();
+  segment.iframes.clear();
+  segment.first = DVD_NOPTS_VALUE;
+  segment.last = DVD_NOPTS_VALUE;
+}
+
+bool cLiveTimeShift::NextSegment()
+{
+  int next = 0;
+
+  if(!m_segments.empty()) {
+    sSegment& current = m_segments[m_write];
+
+    // flush the completed segment in one sequential run
+    if(current.fd != -1)
+      sync_file_range(current.fd, 0, current.used, SYNC_FILE_RANGE_WRITE);
+
+    next = m_write + 1;
+  }
+
+  // grow the buffer up to its configured size
+  if(next == (int)m_segments.size() && next < m_count) {
+    sSegment segment;
+
+    if(OpenSegment(segment, next)) {
+      cMutexLock lock(&m_lock);
+      m_segments.push_back(segment);
+    }
+    // out of disk space / memory ? (continue with the segments we've got)
+    else {
+      m_count = m_segments.size();
+
+      if(m_count < 2) {
+        ERRORLOG("Unable to create timeshift buffer");
+        cMutexLock lock(&m_lock);
+        m_failed = true;
+        return false;
+      }
+    }
+  }
+
+  if(m_segments.empty())
+    return false;
+
+  if(next >= (int)m_segments.size())
+    next = 0;
+
+  cMutexLock lock(&m_lock);
+
+  m_write = next;
+
+  sSegment& segment = m_segments[m_write];
+
+  // recycle the oldest segment
+  if(!segment.index.empty()) {
+    // overrun - the reader continues with the oldest remaining data
+    if(m_read == m_write) {
+      DEBUGLOG("Timeshift buffer overrun");
+      m_read = (m_write + 1) % m_segments.size();
+      m_readIndex = 0;
+      m_readIFrame = 0;
+    }
+
+    ClearSegment(segment);
+  }
+
+  return true;
+}
+
+bool cLiveTimeShift::Write(MsgPacket* p, cStreamInfo::Content content, cStreamInfo::FrameType frametype, int64_t pts)
+{
+  uint32_t length = p->getPacketLength();
+
+  cMutexLock lock(&m_stageLock);
+
+  // staging buffer full (disk too slow) - drop the packet
+  if(m_staged + length > (uint32_t)MaxStagingSize) {
+    m_stalls++;
+
+    if(m_stallTimer.TimedOut()) {
+      ERRORLOG("Timeshift storage too slow - %u bytes staged, %u write stalls", m_staged, m_stalls);
+      m_stallTimer.Set(5000);
+    }
+
+    delete p;
+    return false;
+  }
+
+  sStagedItem item;
+  item.packet = p;
+  item.content = content;
+  item.frametype = frametype;
+  item.pts = pts;
+
+  m_staging.push_back(item);
+
+  m_staged += length;
+  m_stagedMax = std::max(m_stagedMax, m_staged);
+
+  m_stageCond.Broadcast();
+  return true;
+}
+
+void cLiveTimeShift::Action()
+{
+  std::deque<sStagedItem> items;
+
+  while(Running()) {
+    // take all staged packets in one go
+    m_stageLock.Lock();
+
+    if(m_staging.empty()) {
+      m_stageCond.TimedWait(m_stageLock, 1000);
+    }
+
+    items.swap(m_staging);
+    m_stageLock.Unlock();
+
+    if(items.empty()) {
+      continue;
+    }
+
+    while(!items.empty()) {
+      const sStagedItem& item = items.front();
+      uint32_t length = item.packet->getPacketLength();
+
+      if(!Store(item) && !Failed()) {
+        ERRORLOG("Unable to write packet into timeshift ringbuffer !");
+      }
+
+      delete item.packet;
+      items.pop_front();
+
+      cMutexLock lock(&m_stageLock);
+      m_staged -= length;
+    }
+
+    // new data for replay
+    m_writer->Wakeup();
+  }
+
+  while(!items.empty()) {
+    delete items.front().packet;
+    items.pop_front();
+  }
+}
+
+bool cLiveTimeShift::Store(const sStagedItem& item)
+{
+  MsgPacket* p = item.packet;
+  uint32_t length = p->getPacketLength();
+
+  if(length > (uint32_t)SegmentSize)
+    return false;
+
+  if(m_segments.empty() || m_segments[m_write].used + length > (uint32_t)SegmentSize) {
+    if(!NextSegment())
+      return false;
+  }
+
+  // only this thread writes into the segments, readers only
+  // access packets which have been added to the index
+  sSegment& segment = m_segments[m_write];
+  uint32_t offset = segment.used;
+
+  p->copyTo(segment.data + offset);
+
+  cMutexLock lock(&m_lock);
+
+  cStreamInfo::Content content = item.content;
+  int64_t pts = item.pts;
+
+  // index I-frames
+  if(content == cStreamInfo::scVIDEO && item.frametype == cStreamInfo::ftIFRAME && pts != DVD_NOPTS_VALUE) {
+    sIFrame iframe;
+    iframe.pts = pts;
+    iframe.packet = segment.index.size();
+    segment.iframes.push_back(iframe);
+  }
+
+  // time range of the segment (video pts aren't monotonic)
+  if((content == cStreamInfo::scVIDEO || content == cStreamInfo::scAUDIO) && pts != DVD_NOPTS_VALUE) {
+    if(segment.first == DVD_NOPTS_VALUE || pts < segment.first)
+      segment.first = pts;
+    if(segment.last == DVD_NOPTS_VALUE || pts > segment.last)
+      segment.last = pts;
+  }
+
+  segment.index.push_back(offset);
+  segment.used = offset + length;
+
+  return true;
+}
+
+MsgPacket* cLiveTimeShift::Read()
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_segments.empty())
+    return NULL;
+
+  sSegment* segment = &m_segments[m_read];
+
+  // segment completely read - continue with the next one
+  if(m_readIndex >= segment->index.size()) {
+    if(m_read == m_write)
+      return NULL;
+
+    m_read = (m_read + 1) % m_segments.size();
+    m_readIndex = 0;
+    m_readIFrame = 0;
+    segment = &m_segments[m_read];
+
+    if(segment->index.empty())
+      return NULL;
+  }
+
+  uint32_t start = segment->index[m_readIndex];
+  uint32_t end = (m_readIndex + 1 < segment->index.size()) ? segment->index[m_readIndex + 1] : segment->used;
+
+  // keep track of the current position (last I-frame read)
+  while(m_readIFrame < segment->iframes.size() && segment->iframes[m_readIFrame].packet <= m_readIndex) {
+    m_position = segment->iframes[m_readIFrame].pts;
+    m_readIFrame++;
+  }
+
+  m_readIndex++;
+
+  return MsgPacket::create(segment->data + start, end - start);
+}
+
+bool cLiveTimeShift::HasData()
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_segments.empty())
+    return false;
+
+  return (m_readIndex < m_segments[m_read].index.size() || m_read != m_write);
+}
+
+bool cLiveTimeShift::Seek(int64_t pts)
+{
+  cMutexLock lock(&m_lock);
+
+  int size = m_segments.size();
+  int found = -1;
+  uint32_t index = 0;
+  bool done = false;
+
+  // walk from the oldest to the newest segment and pick the last I-frame
+  // at or before the requested time (or the first one available)
+  for(int i = 1; i <= size && !done; i++) {
+    int s = (m_write + i) % size;
+    std::vector<sIFrame>& iframes = m_segments[s].iframes;
+
+    for(uint32_t k = 0; k < iframes.size(); k++) {
+      if(found != -1 && iframes[k].pts > pts) {
+        done = true;
+        break;
+      }
+
+      found = s;
+      index = k;
+    }
+  }
+
+  if(found == -1)
+    return false;
+
+  const sIFrame& iframe = m_segments[found].iframes[index];
+
+  m_read = found;
+  m_readIndex = iframe.packet;
+  m_readIFrame = index;
+  m_position = iframe.pts;
+
+  DEBUGLOG("Timeshift seek to %lli (requested %lli)", (long long)iframe.pts, (long long)pts);
+  return true;
+}
+
+bool cLiveTimeShift::GetRange(int64_t& start, int64_t& end)
+{
+  cMutexLock lock(&m_lock);
+
+  start = DVD_NOPTS_VALUE;
+  end = DVD_NOPTS_VALUE;
+
+  for(std::vector<sSegment>::iterator i = m_segments.begin(); i != m_segments.end(); i++) {
+    if(i->first == DVD_NOPTS_VALUE)
+      continue;
+
+    if(start == DVD_NOPTS_VALUE || i->first < start)
+      start = i->first;
+    if(end == DVD_NOPTS_VALUE || i->last > end)
+      end = i->last;
+  }
+
+  return (start != DVD_NOPTS_VALUE);
+}
+
+int64_t cLiveTimeShift::GetPosition()
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_position != DVD_NOPTS_VALUE)
+    return m_position;
+
+  // nothing read yet - we're at the start of the buffer
+  int64_t start, end;
+  GetRange(start, end);
+
+  return start;
+}
+
+uint32_t cLiveTimeShift::GetStagedBytes()
+{
+  cMutexLock lock(&m_stageLock);
+  return m_staged;
+}
+
+uint32_t cLiveTimeShift::GetStalls()
+{
+  cMutexLock lock(&m_stageLock);
+  return m_stalls;
+}
+
+bool cLiveTimeShift::Failed()
+{
+  cMutexLock lock(&m_lock);
+  return m_failed;
+}
@@ -0,0 +1,159 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_LIVETIMESHIFT_H
+#define XVDR_LIVETIMESHIFT_H
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include <vdr/thread.h>
+#include <vdr/tools.h>
+#include "demuxer/streaminfo.h"
+
+class MsgPacket;
+class cXVDRWriter;
+
+// Timeshift ring-buffer on disk.
+// The buffer consists of fixed-size, preallocated segments which are mapped
+// into memory and written strictly sequentially. Each segment keeps an index of
+// the packet boundaries and of the I-frames (for seeking). If the buffer is
+// full, the oldest segment is recycled.
+// The first segments may be held in memory, so short pauses never touch the
+// disk.
+// Packets are staged in memory and stored by a separate thread, so a slow disk
+// never blocks the demuxer.
+
+class cLiveTimeShift : public cThread
+{
+public:
+
+  cLiveTimeShift(const cString& dir, int id, uint64_t size, uint64_t memory, cXVDRWriter* writer);
+
+  virtual ~cLiveTimeShift();
+
+  bool Write(MsgPacket* p, cStreamInfo::Content content = cStreamInfo::scNONE, cStreamInfo::FrameType frametype = cStreamInfo::ftUNKNOWN, int64_t pts = 0);
+
+  MsgPacket* Read();
+
+  bool HasData();
+
+  bool Seek(int64_t pts);
+
+  bool GetRange(int64_t& start, int64_t& end);
+
+  int64_t GetPosition();
+
+  uint32_t GetStagedBytes();
+
+  uint32_t GetStalls();
+
+  bool Failed();
+
+  enum {
+    SegmentSize = 16 * 1024 * 1024,
+    MaxStagingSize = 32 * 1024 * 1024
+  };
+
+protected:
+
+  struct sIFrame {
+    int64_t  pts;
+    uint32_t packet;  // position in the packet index
+  };
+
+  struct sStagedItem {
+    MsgPacket*             packet;
+    cStreamInfo::Content   content;
+    cStreamInfo::FrameType frametype;
+    int64_t                pts;
+  };
+
+  struct sSegment {
+    cString               filename;
+    int                   fd;
+    uint8_t*              data;
+    uint32_t              used;
+    std::vector<uint32_t> index;
+    std::vector<sIFrame>  iframes;
+    int64_t               first;  // pts range of the audio / video packets
+    int64_t               last;
+  };
+
+  bool OpenSegment(sSegment& segment, int number);
+
+  void CloseSegment(sSegment& segment);
+
+  void Action();
+
+  bool Store(const sStagedItem& item);
+
+  bool NextSegment();
+
+  void ClearSegment(sSegment& segment);
+
+  std::vector<sSegment> m_segments;
+
+  cString m_dir;
+
+  int m_id;
+
+  int m_count;
+
+  // the buffer couldn't be created
+  bool m_failed;
+
+  int m_memoryCount;
+
+  int m_write;
+
+  int m_read;
+
+  uint32_t m_readIndex;
+
+  uint32_t m_readIFrame;
+
+  int64_t m_position;
+
+  cMutex m_lock;
+
+  // staging buffer
+  std::deque<sStagedItem> m_staging;
+
+  uint32_t m_staged;
+
+  uint32_t m_stagedMax;
+
+  uint32_t m_stalls;
+
+  cTimeMs m_stallTimer;
+
+  cMutex m_stageLock;
+
+  cCondVar m_stageCond;
+
+  cXVDRWriter* m_writer;
+};
+
+#endif // XVDR_LIVETIMESHIFT_H
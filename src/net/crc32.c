@@ -0,0 +1,312 @@
+#include <string.h>
+#include <pthread.h>
+
+#include "os-config.h"
+#include "crc32.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CRC32_PCLMUL
+#include <cpuid.h>
+#include <wmmintrin.h>
+#include <smmintrin.h>
+#endif
+
+#if defined(__aarch64__) && (defined(__ARM_FEATURE_CRC32) || __GNUC__ >= 9)
+#define CRC32_ARMV8
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+static uint32_t crc32_tab[8][256];
+
+static pthread_once_t crc32once = PTHREAD_ONCE_INIT;
+
+CRC32::Kernel CRC32::m_kernel = CRC32::resolve;
+
+static const char* crc32engine = "table";
+
+static uint32_t crc32_table(uint32_t crc, const uint8_t* p, size_t size) {
+	while(size--) {
+		crc = crc32_tab[0][(crc ^ *p++) & 0xFF] ^(crc >> 8);
+	}
+
+	return crc;
+}
+
+static uint32_t crc32_slice8(uint32_t crc, const uint8_t* p, size_t size) {
+	while(size > 0 && ((uintptr_t)p & 7) != 0) {
+		crc = crc32_tab[0][(crc ^ *p++) & 0xFF] ^(crc >> 8);
+		size--;
+	}
+
+	while(size >= 8) {
+		uint32_t one;
+		uint32_t two;
+
+		memcpy(&one, p, sizeof(one));
+		memcpy(&two, p + 4, sizeof(two));
+
+		one = le32toh(one) ^ crc;
+		two = le32toh(two);
+
+		crc = crc32_tab[7][one & 0xFF] ^
+		      crc32_tab[6][(one >> 8) & 0xFF] ^
+		      crc32_tab[5][(one >> 16) & 0xFF] ^
+		      crc32_tab[4][one >> 24] ^
+		      crc32_tab[3][two & 0xFF] ^
+		      crc32_tab[2][(two >> 8) & 0xFF] ^
+		      crc32_tab[1][(two >> 16) & 0xFF] ^
+		      crc32_tab[0][two >> 24];
+
+		p += 8;
+		size -= 8;
+	}
+
+	return crc32_table(crc, p, size);
+}
+
+#ifdef CRC32_PCLMUL
+
+// carry-less multiplication folding
+// (Intel "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction")
+
+__attribute__((target("pclmul,sse4.1")))
+static uint32_t crc32_pclmul_fold(uint32_t crc, const uint8_t* buf, size_t size) {
+	static const uint64_t __attribute__((aligned(16))) k1k2[] = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+	static const uint64_t __attribute__((aligned(16))) k3k4[] = { 0x01751997d0ULL, 0x00ccaa009eULL };
+	static const uint64_t __attribute__((aligned(16))) k5k0[] = { 0x0163cd6124ULL, 0x0000000000ULL };
+	static const uint64_t __attribute__((aligned(16))) poly[] = { 0x01db710641ULL, 0x01f7011641ULL };
+
+	__m128i x0, x1, x2, x3, x4, x5, x6, x7, x8, y5, y6, y7, y8;
+
+	// there's at least one block of 64 bytes
+	x1 = _mm_loadu_si128((__m128i*)(buf + 0x00));
+	x2 = _mm_loadu_si128((__m128i*)(buf + 0x10));
+	x3 = _mm_loadu_si128((__m128i*)(buf + 0x20));
+	x4 = _mm_loadu_si128((__m128i*)(buf + 0x30));
+
+	x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(crc));
+	x0 = _mm_load_si128((__m128i*)k1k2);
+
+	buf += 64;
+	size -= 64;
+
+	// fold blocks of 64 bytes in parallel
+	while(size >= 64) {
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+		x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+		x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+		x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+		x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+		y5 = _mm_loadu_si128((__m128i*)(buf + 0x00));
+		y6 = _mm_loadu_si128((__m128i*)(buf + 0x10));
+		y7 = _mm_loadu_si128((__m128i*)(buf + 0x20));
+		y8 = _mm_loadu_si128((__m128i*)(buf + 0x30));
+
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), y5);
+		x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), y6);
+		x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), y7);
+		x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), y8);
+
+		buf += 64;
+		size -= 64;
+	}
+
+	// fold into 128 bits
+	x0 = _mm_load_si128((__m128i*)k3k4);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+
+	x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+	x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+	// fold remaining blocks of 16 bytes
+	while(size >= 16) {
+		x2 = _mm_loadu_si128((__m128i*)buf);
+
+		x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+		x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+		x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+
+		buf += 16;
+		size -= 16;
+	}
+
+	// fold 128 bits to 64 bits
+	x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+	x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+	x1 = _mm_srli_si128(x1, 8);
+	x1 = _mm_xor_si128(x1, x2);
+
+	x0 = _mm_loadl_epi64((__m128i*)k5k0);
+
+	x2 = _mm_srli_si128(x1, 4);
+	x1 = _mm_and_si128(x1, x3);
+	x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	// barrett reduction to 32 bits
+	x0 = _mm_load_si128((__m128i*)poly);
+
+	x2 = _mm_and_si128(x1, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+	x2 = _mm_and_si128(x2, x3);
+	x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+	x1 = _mm_xor_si128(x1, x2);
+
+	return (uint32_t)_mm_extract_epi32(x1, 1);
+}
+
+static uint32_t crc32_pclmul(uint32_t crc, const uint8_t* p, size_t size) {
+	if(size >= 64) {
+		size_t blocks = size & ~(size_t)15;
+
+		crc = crc32_pclmul_fold(crc, p, blocks);
+		p += blocks;
+		size -= blocks;
+	}
+
+	return crc32_slice8(crc, p, size);
+}
+
+static bool crc32_pclmul_supported() {
+	unsigned int eax, ebx, ecx, edx;
+
+	if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) {
+		return false;
+	}
+
+	return ((ecx & bit_PCLMUL) != 0 && (ecx & bit_SSE4_1) != 0);
+}
+
+#endif // CRC32_PCLMUL
+
+#ifdef CRC32_ARMV8
+
+__attribute__((target("+crc")))
+static uint32_t crc32_armv8(uint32_t crc, const uint8_t* p, size_t size) {
+	while(size > 0 && ((uintptr_t)p & 7) != 0) {
+		crc = __crc32b(crc, *p++);
+		size--;
+	}
+
+	while(size >= 8) {
+		uint64_t v;
+		memcpy(&v, p, sizeof(v));
+		crc = __crc32d(crc, v);
+		p += 8;
+		size -= 8;
+	}
+
+	while(size--) {
+		crc = __crc32b(crc, *p++);
+	}
+
+	return crc;
+}
+
+static bool crc32_armv8_supported() {
+	return ((getauxval(AT_HWCAP) & HWCAP_CRC32) != 0);
+}
+
+#endif // CRC32_ARMV8
+
+static CRC32::Kernel crc32_lookup(const char*& name) {
+	if(strcmp(name, "table") == 0) {
+		name = "table";
+		return crc32_table;
+	}
+
+	if(strcmp(name, "slice8") == 0) {
+		name = "slice8";
+		return crc32_slice8;
+	}
+
+#ifdef CRC32_PCLMUL
+	if(strcmp(name, "pclmul") == 0 && crc32_pclmul_supported()) {
+		name = "pclmul";
+		return crc32_pclmul;
+	}
+#endif
+
+#ifdef CRC32_ARMV8
+	if(strcmp(name, "armv8") == 0 && crc32_armv8_supported()) {
+		name = "armv8";
+		return crc32_armv8;
+	}
+#endif
+
+	return NULL;
+}
+
+void CRC32::init() {
+	// generate tables for the reflected polynomial
+	for(int i = 0; i < 256; i++) {
+		uint32_t crc = i;
+
+		for(int j = 0; j < 8; j++) {
+			crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : (crc >> 1);
+		}
+
+		crc32_tab[0][i] = crc;
+	}
+
+	for(int i = 0; i < 256; i++) {
+		for(int k = 1; k < 8; k++) {
+			uint32_t crc = crc32_tab[k - 1][i];
+			crc32_tab[k][i] = (crc >> 8) ^ crc32_tab[0][crc & 0xFF];
+		}
+	}
+
+	// pick the fastest supported kernel
+	static const char* engines[] = { "pclmul", "armv8", "slice8" };
+
+	for(unsigned int i = 0; i < sizeof(engines) / sizeof(engines[0]); i++) {
+		const char* name = engines[i];
+		Kernel kernel = crc32_lookup(name);
+
+		if(kernel != NULL) {
+			crc32engine = name;
+			m_kernel = kernel;
+			return;
+		}
+	}
+}
+
+uint32_t CRC32::resolve(uint32_t crc, const uint8_t* buf, size_t size) {
+	pthread_once(&crc32once, init);
+	return m_kernel(crc, buf, size);
+}
+
+bool CRC32::select(const char* name) {
+	pthread_once(&crc32once, init);
+
+	Kernel kernel = crc32_lookup(name);
+
+	if(kernel == NULL) {
+		return false;
+	}
+
+	crc32engine = name;
+	m_kernel = kernel;
+
+	return true;
+}
+
+const char* CRC32::engine() {
+	pthread_once(&crc32once, init);
+	return crc32engine;
+}
@@ -0,0 +1,93 @@
+/** \file crc32.h
+	Header file for the CRC32 class.
+	This include file defines the shared CRC32 checksum engine
+*/
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+	@short CRC32 checksum engine
+
+	Computes the reflected CRC32 (polynomial 0xEDB88320, as used by zlib and ethernet).
+	The kernel is selected at runtime from the fastest one supported by the cpu
+	(PCLMULQDQ on x86, CRC32 instructions on ARMv8, slicing-by-8 otherwise).
+	All kernels produce bit-exact results.
+*/
+
+class CRC32 {
+public:
+
+	typedef uint32_t (*Kernel)(uint32_t crc, const uint8_t* buf, size_t size);
+
+	/**
+	Compute a CRC32 checksum.
+
+	@param  buf		pointer to data array
+	@param  size	size of array in bytes
+	@return 32bit crc
+	*/
+	static uint32_t checksum(const uint8_t* buf, size_t size) {
+		return (update(0xFFFFFFFF, buf, size) ^ ~0U);
+	}
+
+	/**
+	Update a CRC32 checksum.
+	Continues a checksum over another block of data. Start with 0xFFFFFFFF and
+	finalize the result with ~0U.
+
+	@param  crc		current (non-finalized) crc state
+	@param  buf		pointer to data array
+	@param  size	size of array in bytes
+	@return updated crc state
+	*/
+	static uint32_t update(uint32_t crc, const uint8_t* buf, size_t size) {
+		return m_kernel(crc, buf, size);
+	}
+
+	/**
+	Select kernel.
+	Forces a specific kernel ("table", "slice8", "pclmul" or "armv8").
+
+	@param  name	name of the kernel
+	@return true on success / false if the kernel isn't supported on this cpu
+	*/
+	static bool select(const char* name);
+
+	/**
+	Get kernel name.
+
+	@return name of the active kernel
+	*/
+	static const char* engine();
+
+private:
+
+	static void init();
+
+	static uint32_t resolve(uint32_t crc, const uint8_t* buf, size_t size);
+
+	static Kernel m_kernel;
+};
+
+/*
+@startuml
+
+class CRC32 {
+.. checksum ..
++{static} uint32_t checksum(const uint8_t* buf, size_t size)
++{static} uint32_t update(uint32_t crc, const uint8_t* buf, size_t size)
+.. kernel selection ..
++{static} bool select(const char* name)
++{static} const char* engine()
+--
+-{static} Kernel m_kernel
+}
+
+@enduml
+*/
+
+#endif // CRC32_H
@@ -6,14 +6,21 @@
 #include <zlib.h>
 #endif
 
+#ifdef HAVE_LZ4
+#include <lz4.h>
+#endif
+
 #include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <iostream>
+#include <new>
 #include <unistd.h>
 
 #include "os-config.h"
 #include "msgpacket.h"
+#include "msgpool.h"
+#include "crc32.h"
 
 #define get_impl(T, f) \
 	if((m_readposition + sizeof(T)) > m_usage) { \
@@ -31,86 +38,126 @@
 	m_usage += sizeof(T); \
 	return true
 
-pthread_mutex_t MsgPacket::uidmutex = PTHREAD_MUTEX_INITIALIZER;
-
 uint32_t MsgPacket::globalUID = 1;
 
-uint32_t MsgPacket::crc32_tab[] = {
-	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
-	0xe963a535, 0x9e6495a3, 0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
-	0x09b64c2b, 0x7eb17cbd, 0xe7b82d07, 0x90bf1d91, 0x1db71064, 0x6ab020f2,
-	0xf3b97148, 0x84be41de, 0x1adad47d, 0x6ddde4eb, 0xf4d4b551, 0x83d385c7,
-	0x136c9856, 0x646ba8c0, 0xfd62f97a, 0x8a65c9ec, 0x14015c4f, 0x63066cd9,
-	0xfa0f3d63, 0x8d080df5, 0x3b6e20c8, 0x4c69105e, 0xd56041e4, 0xa2677172,
-	0x3c03e4d1, 0x4b04d447, 0xd20d85fd, 0xa50ab56b, 0x35b5a8fa, 0x42b2986c,
-	0xdbbbc9d6, 0xacbcf940, 0x32d86ce3, 0x45df5c75, 0xdcd60dcf, 0xabd13d59,
-	0x26d930ac, 0x51de003a, 0xc8d75180, 0xbfd06116, 0x21b4f4b5, 0x56b3c423,
-	0xcfba9599, 0xb8bda50f, 0x2802b89e, 0x5f058808, 0xc60cd9b2, 0xb10be924,
-	0x2f6f7c87, 0x58684c11, 0xc1611dab, 0xb6662d3d, 0x76dc4190, 0x01db7106,
-	0x98d220bc, 0xefd5102a, 0x71b18589, 0x06b6b51f, 0x9fbfe4a5, 0xe8b8d433,
-	0x7807c9a2, 0x0f00f934, 0x9609a88e, 0xe10e9818, 0x7f6a0dbb, 0x086d3d2d,
-	0x91646c97, 0xe6635c01, 0x6b6b51f4, 0x1c6c6162, 0x856530d8, 0xf262004e,
-	0x6c0695ed, 0x1b01a57b, 0x8208f4c1, 0xf50fc457, 0x65b0d9c6, 0x12b7e950,
-	0x8bbeb8ea, 0xfcb9887c, 0x62dd1ddf, 0x15da2d49, 0x8cd37cf3, 0xfbd44c65,
-	0x4db26158, 0x3ab551ce, 0xa3bc0074, 0xd4bb30e2, 0x4adfa541, 0x3dd895d7,
-	0xa4d1c46d, 0xd3d6f4fb, 0x4369e96a, 0x346ed9fc, 0xad678846, 0xda60b8d0,
-	0x44042d73, 0x33031de5, 0xaa0a4c5f, 0xdd0d7cc9, 0x5005713c, 0x270241aa,
-	0xbe0b1010, 0xc90c2086, 0x5768b525, 0x206f85b3, 0xb966d409, 0xce61e49f,
-	0x5edef90e, 0x29d9c998, 0xb0d09822, 0xc7d7a8b4, 0x59b33d17, 0x2eb40d81,
-	0xb7bd5c3b, 0xc0ba6cad, 0xedb88320, 0x9abfb3b6, 0x03b6e20c, 0x74b1d29a,
-	0xead54739, 0x9dd277af, 0x04db2615, 0x73dc1683, 0xe3630b12, 0x94643b84,
-	0x0d6d6a3e, 0x7a6a5aa8, 0xe40ecf0b, 0x9309ff9d, 0x0a00ae27, 0x7d079eb1,
-	0xf00f9344, 0x8708a3d2, 0x1e01f268, 0x6906c2fe, 0xf762575d, 0x806567cb,
-	0x196c3671, 0x6e6b06e7, 0xfed41b76, 0x89d32be0, 0x10da7a5a, 0x67dd4acc,
-	0xf9b9df6f, 0x8ebeeff9, 0x17b7be43, 0x60b08ed5, 0xd6d6a3e8, 0xa1d1937e,
-	0x38d8c2c4, 0x4fdff252, 0xd1bb67f1, 0xa6bc5767, 0x3fb506dd, 0x48b2364b,
-	0xd80d2bda, 0xaf0a1b4c, 0x36034af6, 0x41047a60, 0xdf60efc3, 0xa867df55,
-	0x316e8eef, 0x4669be79, 0xcb61b38c, 0xbc66831a, 0x256fd2a0, 0x5268e236,
-	0xcc0c7795, 0xbb0b4703, 0x220216b9, 0x5505262f, 0xc5ba3bbe, 0xb2bd0b28,
-	0x2bb45a92, 0x5cb36a04, 0xc2d7ffa7, 0xb5d0cf31, 0x2cd99e8b, 0x5bdeae1d,
-	0x9b64c2b0, 0xec63f226, 0x756aa39c, 0x026d930a, 0x9c0906a9, 0xeb0e363f,
-	0x72076785, 0x05005713, 0x95bf4a82, 0xe2b87a14, 0x7bb12bae, 0x0cb61b38,
-	0x92d28e9b, 0xe5d5be0d, 0x7cdcefb7, 0x0bdbdf21, 0x86d3d2d4, 0xf1d4e242,
-	0x68ddb3f8, 0x1fda836e, 0x81be16cd, 0xf6b9265b, 0x6fb077e1, 0x18b74777,
-	0x88085ae6, 0xff0f6a70, 0x66063bca, 0x11010b5c, 0x8f659eff, 0xf862ae69,
-	0x616bffd3, 0x166ccf45, 0xa00ae278, 0xd70dd2ee, 0x4e048354, 0x3903b3c2,
-	0xa7672661, 0xd06016f7, 0x4969474d, 0x3e6e77db, 0xaed16a4a, 0xd9d65adc,
-	0x40df0b66, 0x37d83bf0, 0xa9bcae53, 0xdebb9ec5, 0x47b2cf7f, 0x30b5ffe9,
-	0xbdbdf21c, 0xcabac28a, 0x53b39330, 0x24b4a3a6, 0xbad03605, 0xcdd70693,
-	0x54de5729, 0x23d967bf, 0xb3667a2e, 0xc4614ab8, 0x5d681b02, 0x2a6f2b94,
-	0xb40bbe37, 0xc30c8ea1, 0x5a05df1b, 0x2d02ef8d
-};
-
-
-MsgPacket::MsgPacket() : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_freezed(false), m_payloadchecksum(true) {
+MsgPayload::MsgPayload(uint8_t* data, uint32_t length, uint32_t capacity) : m_data(data), m_length(length), m_capacity(capacity), m_refcount(1) {
+}
+
+MsgPayload::~MsgPayload() {
+	if(m_capacity > 0) {
+		MsgPool::release(m_data, m_capacity);
+	}
+}
+
+void* MsgPayload::operator new(size_t size) {
+	uint32_t capacity = size;
+	void* p = MsgPool::alloc(capacity);
+
+	if(p == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void MsgPayload::operator delete(void* p, size_t size) {
+	MsgPool::release((uint8_t*)p, MsgPool::capacity(size));
+}
+
+MsgPayload* MsgPayload::create(uint32_t length) {
+	uint32_t capacity = (length > 0) ? length : 1;
+	uint8_t* data = MsgPool::alloc(capacity);
+
+	if(data == NULL) {
+		return NULL;
+	}
+
+	return new MsgPayload(data, length, capacity);
+}
+
+MsgPayload* MsgPayload::wrap(uint8_t* data, uint32_t length) {
+	return new MsgPayload(data, length, 0);
+}
+
+MsgPayload* MsgPayload::ref() {
+	__sync_add_and_fetch(&m_refcount, 1);
+	return this;
+}
+
+void MsgPayload::unref() {
+	if(__sync_sub_and_fetch(&m_refcount, 1) == 0) {
+		delete this;
+	}
+}
+
+MsgPacket::MsgPacket() : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_external(NULL), m_buffer(NULL), m_freezed(false), m_payloadchecksum(true) {
 	Init(0, 0, 0);
 }
 
-MsgPacket::MsgPacket(uint16_t msgid, uint16_t type, uint32_t uid) : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_freezed(false), m_payloadchecksum(true) {
-	Init(msgid, type, uid);
+MsgPacket::MsgPacket(uint16_t msgid, uint16_t type, uint32_t uid, uint32_t capacity) : m_packet(NULL), m_size(InitialPacketSize), m_usage(HeaderLength), m_readposition(HeaderLength), m_external(NULL), m_buffer(NULL), m_freezed(false), m_payloadchecksum(true) {
+	Init(msgid, type, uid, capacity);
+}
+
+MsgPacket::MsgPacket(uint8_t* data, uint32_t length, MsgPayload* buffer) : m_packet(data), m_size(length), m_usage(length), m_readposition(HeaderLength), m_external(NULL), m_buffer(buffer->ref()), m_freezed(false), m_payloadchecksum(true) {
 }
 
 MsgPacket::~MsgPacket() {
-	free(m_packet);
+	if(m_external != NULL) {
+		m_external->unref();
+	}
+
+	releaseBuffer();
+}
+
+void MsgPacket::releaseBuffer() {
+	if(m_buffer != NULL) {
+		m_buffer->unref();
+		m_buffer = NULL;
+	}
+	else {
+		MsgPool::release(m_packet, m_size);
+	}
+
+	m_packet = NULL;
 }
 
-void MsgPacket::Init(uint16_t msgid, uint16_t type, uint32_t uid) {
-	m_packet = (uint8_t*)malloc(m_size);
+void* MsgPacket::operator new(size_t size) {
+	uint32_t capacity = size;
+	void* p = MsgPool::alloc(capacity);
+
+	if(p == NULL) {
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+void MsgPacket::operator delete(void* p, size_t size) {
+	MsgPool::release((uint8_t*)p, MsgPool::capacity(size));
+}
+
+void MsgPacket::Init(uint16_t msgid, uint16_t type, uint32_t uid, uint32_t capacity) {
+	if(HeaderLength + capacity > m_size) {
+		m_size = HeaderLength + capacity;
+	}
+
+	m_packet = MsgPool::alloc(m_size);
 
 	if(m_packet == NULL) {
+		m_size = 0;
 		return;
 	}
 
-	pthread_mutex_lock(&uidmutex);
-
 	if(uid <= 0) {
-		uid = globalUID++;
-	}
-	else if(uid > globalUID) {
-		globalUID = uid + 1;
+		uid = __sync_fetch_and_add(&globalUID, 1);
 	}
+	else {
+		uint32_t current = globalUID;
 
-	pthread_mutex_unlock(&uidmutex);
+		while(uid > current && !__sync_bool_compare_and_swap(&globalUID, current, uid + 1)) {
+			current = globalUID;
+		}
+	}
 
 	memset(m_packet, 0, HeaderLength);
 
@@ -192,7 +239,38 @@ bool MsgPacket::put_Blob(uint8_t source[], uint32_t length) {
 	return true;
 }
 
+bool MsgPacket::attach(MsgPayload* payload) {
+	if(payload == NULL || m_external != NULL || m_freezed) {
+		return false;
+	}
+
+	m_external = payload->ref();
+	return true;
+}
+
+void MsgPacket::flatten() {
+	if(m_external == NULL) {
+		return;
+	}
+
+	MsgPayload* payload = m_external;
+	m_external = NULL;
+
+	uint8_t* p = reserve(payload->length());
+
+	if(p != NULL) {
+		memcpy(p, payload->data(), payload->length());
+	}
+
+	payload->unref();
+}
+
 void MsgPacket::clear() {
+	if(m_external != NULL) {
+		m_external->unref();
+		m_external = NULL;
+	}
+
 	m_usage = HeaderLength;
 	m_readposition = HeaderLength;
 }
@@ -289,19 +367,21 @@ bool MsgPacket::get_Blob(uint8_t dest[], uint32_t length) {
 }
 
 uint8_t* MsgPacket::getPacket() {
+	flatten();
 	return m_packet;
 }
 
 uint32_t MsgPacket::getPacketLength() {
-	return m_usage;
+	return m_usage + (m_external ? m_external->length() : 0);
 }
 
 uint8_t* MsgPacket::getPayload() {
+	flatten();
 	return m_packet + HeaderLength;
 }
 
 uint32_t MsgPacket::getPayloadLength() {
-	return m_usage - HeaderLength;
+	return getPacketLength() - HeaderLength;
 }
 
 uint32_t MsgPacket::getUID() {
@@ -348,18 +428,24 @@ void MsgPacket::freeze() {
 	uint32_t payloadCheckSum = 0;
 
 	if(getPayloadLength() > 0 && m_payloadchecksum) {
-		payloadCheckSum = crc32(m_packet + HeaderLength, m_usage - HeaderLength);
+		payloadCheckSum = CRC32::update(0xFFFFFFFF, m_packet + HeaderLength, m_usage - HeaderLength);
+
+		if(m_external != NULL) {
+			payloadCheckSum = CRC32::update(payloadCheckSum, m_external->data(), m_external->length());
+		}
+
+		payloadCheckSum ^= ~0U;
 	}
 
 	writePacket<uint32_t>(PayloadCheckSumPos, htobe32(payloadCheckSum));
-	writePacket<uint32_t>(PayloadLengthPos, htobe32(m_usage - HeaderLength));
+	writePacket<uint32_t>(PayloadLengthPos, htobe32(getPayloadLength()));
 	writePacket<uint32_t>(CheckSumPos, htobe32(crc32(m_packet, CheckSumPos)));
 
 	m_freezed = true;
 }
 
 bool MsgPacket::checkPacketSize(uint32_t bytes) {
-	if(bytes == 0) {
+	if(bytes == 0 || m_external != NULL) {
 		return false;
 	}
 
@@ -367,64 +453,116 @@ bool MsgPacket::checkPacketSize(uint32_t bytes) {
 		return true;
 	}
 
-	if(bytes < IncrementPacketSize) {
-		bytes = IncrementPacketSize;
+	// grow geometrically
+	uint32_t size = m_size * 2;
+
+	if(size < m_usage + bytes) {
+		size = m_usage + bytes;
 	}
 
-	uint8_t* buffer = (uint8_t*)realloc((void*)m_packet, m_usage + bytes);
+	uint8_t* buffer = MsgPool::alloc(size);
 
 	if(buffer == NULL) {
-		buffer = (uint8_t*)malloc(m_usage + bytes);
-
-		if(buffer == NULL) {
-			return false;
-		}
-
-		memcpy(buffer, m_packet, m_usage);
-		free(m_packet);
+		return false;
 	}
 
+	memcpy(buffer, m_packet, m_usage);
+	releaseBuffer();
+
 	m_packet = buffer;
-	m_size = m_usage + bytes;
+	m_size = size;
 	return true;
 }
 
 uint32_t MsgPacket::crc32(const uint8_t* buf, int size) {
-	uint32_t crc = 0xFFFFFFFF;
-	const uint8_t* p = buf;
+	return CRC32::checksum(buf, size);
+}
+
+bool MsgPacket::write(int fd, int timeout_ms) {
+	freeze();
+
+	struct iovec iov[2];
+	int iovcnt = 1;
 
-	while(size--) {
-		crc = crc32_tab[(crc ^ *p++) & 0xFF] ^(crc >> 8);
+	iov[0].iov_base = m_packet;
+	iov[0].iov_len = m_usage;
+
+	if(m_external != NULL) {
+		iov[1].iov_base = m_external->data();
+		iov[1].iov_len = m_external->length();
+		iovcnt++;
 	}
 
-	return (crc ^ ~0U);
+	return (socketwritev(fd, iov, iovcnt, timeout_ms) == 0);
 }
 
-bool MsgPacket::write(int fd, int timeout_ms) {
+uint32_t MsgPacket::copyTo(uint8_t* data) {
 	freeze();
 
-	uint32_t written = 0;
+	memcpy(data, m_packet, m_usage);
 
-	while(written < m_usage) {
-		if(pollfd(fd, timeout_ms, false) == 0) {
-			return false;
-		}
+	if(m_external != NULL) {
+		memcpy(data + m_usage, m_external->data(), m_external->length());
+	}
 
-		int rc = send(fd, (sendval_t*)(m_packet + written), m_usage - written, MSG_DONTWAIT | MSG_NOSIGNAL);
+	return getPacketLength();
+}
 
-		if(rc == -1 && sockerror() == ENOTSOCK) {
-			rc = ::write(fd, m_packet + written, m_usage - written);
-		}
+MsgPacket* MsgPacket::create(const uint8_t* data, uint32_t length) {
+	if(length < (uint32_t)HeaderLength) {
+		return NULL;
+	}
+
+	uint32_t value;
+	memcpy(&value, data + PayloadLengthPos, sizeof(value));
+
+	if(HeaderLength + be32toh(value) != length) {
+		return NULL;
+	}
+
+	MsgPayload* buffer = MsgPayload::create(length);
+
+	if(buffer == NULL) {
+		return NULL;
+	}
+
+	memcpy(buffer->data(), data, length);
+
+	MsgPacket* p = new MsgPacket(buffer->data(), length, buffer);
+	p->m_payloadchecksum = (p->getPayloadCheckSum() != 0);
+
+	buffer->unref();
+	return p;
+}
+
+bool MsgPacket::write(int fd, MsgPacket** packets, int count, int timeout_ms) {
+	struct iovec iov[2 * WriteBatchSize];
+
+	while(count > 0) {
+		int iovcnt = 0;
+		int n = (count > WriteBatchSize) ? WriteBatchSize : count;
+
+		for(int i = 0; i < n; i++) {
+			MsgPacket* p = packets[i];
+			p->freeze();
+
+			iov[iovcnt].iov_base = p->m_packet;
+			iov[iovcnt].iov_len = p->m_usage;
+			iovcnt++;
 
-		if(rc == -1 || rc == 0) {
-			if(sockerror() == SEWOULDBLOCK) {
-				continue;
+			if(p->m_external != NULL) {
+				iov[iovcnt].iov_base = p->m_external->data();
+				iov[iovcnt].iov_len = p->m_external->length();
+				iovcnt++;
 			}
+		}
+
+		packets += n;
+		count -= n;
 
+		if(socketwritev(fd, iov, iovcnt, timeout_ms, (count > 0)) != 0) {
 			return false;
 		}
-
-		written += rc;
 	}
 
 	return true;
@@ -601,78 +739,126 @@ bool MsgPacket::readstream(std::istream& in, MsgPacket& p) {
 	return true;
 }
 
-bool MsgPacket::compress(int level) {
-#ifndef HAVE_ZLIB
-	return false;
-#else
+bool MsgPacket::codecSupported(int codec) {
+	switch(codec) {
+#ifdef HAVE_ZLIB
+		case CodecZlib:
+			return true;
+#endif
+#ifdef HAVE_LZ4
+		case CodecLZ4:
+			return true;
+#endif
+		default:
+			return false;
+	}
+}
 
-	if(level <= 0 || level > 9 || m_freezed) {
+bool MsgPacket::compress(int level, int codec) {
+	if(level <= 0 || level > 9 || m_freezed || !codecSupported(codec)) {
 		return false;
 	}
 
+	// merge an attached payload first (m_usage covers the whole packet then)
+	flatten();
+
 	uint32_t uncompressedsize = getPayloadLength();
 
 	if(uncompressedsize == 0) {
 		return true;
 	}
 
-	uint8_t* compressed = (uint8_t*)malloc(uncompressedsize);
-	uLongf compressedsize = uncompressedsize;
+	// compress into a new packet buffer (no larger than the uncompressed packet)
+	uint32_t size = m_usage;
+	uint8_t* buffer = MsgPool::alloc(size);
 
-	if(compressed == NULL) {
-		return NULL;
+	if(buffer == NULL) {
+		return false;
 	}
 
-	if(::compress2(compressed, &compressedsize, getPayload(), uncompressedsize, level) != Z_OK) {
-		free(compressed);
-		return false;
+	uint32_t compressedsize = 0;
+	bool rc = false;
+
+#ifdef HAVE_ZLIB
+	if(codec == CodecZlib) {
+		uLongf length = uncompressedsize;
+		rc = (::compress2(buffer + HeaderLength, &length, getPayload(), uncompressedsize, level) == Z_OK);
+		compressedsize = length;
 	}
+#endif
 
-	clear();
-	uint8_t* data = reserve(compressedsize);
+#ifdef HAVE_LZ4
+	if(codec == CodecLZ4) {
+		int length = LZ4_compress_fast((const char*)getPayload(), (char*)(buffer + HeaderLength), uncompressedsize, uncompressedsize, 10 - level);
+		rc = (length > 0);
+		compressedsize = length;
+	}
+#endif
 
-	if(data == NULL) {
-		free(compressed);
+	if(!rc) {
+		MsgPool::release(buffer, size);
 		return false;
 	}
 
-	memcpy(data, compressed, compressedsize);
-	free(compressed);
+	memcpy(buffer, m_packet, HeaderLength);
+	releaseBuffer();
+
+	m_packet = buffer;
+	m_size = size;
+	m_usage = HeaderLength + compressedsize;
+	m_readposition = HeaderLength;
 
-	m_freezed = false;
 	writePacket<uint32_t>(UncompressedPayloadLengthPos, htobe32(uncompressedsize));
 	freeze();
 
 	return true;
-#endif
 }
 
 bool MsgPacket::isCompressed() {
 	return (be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos)) != 0);
 }
 
-bool MsgPacket::uncompress() {
-#ifndef HAVE_ZLIB
-	return false;
-#else
-	uLongf uncompressedsize = be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos));
-	uint8_t* uncompressed = (uint8_t*)malloc(uncompressedsize);
+bool MsgPacket::uncompress(int codec) {
+	if(!codecSupported(codec)) {
+		return false;
+	}
+
+	uint32_t uncompressedsize = be32toh(readPacket<uint32_t>(UncompressedPayloadLengthPos));
+	uint32_t size = HeaderLength + uncompressedsize;
+	uint8_t* buffer = MsgPool::alloc(size);
 
-	if(::uncompress(uncompressed, &uncompressedsize, getPayload(), getPayloadLength()) != Z_OK) {
-		free(uncompressed);
+	if(buffer == NULL) {
 		return false;
 	}
 
-	clear();
-	uint8_t* data = reserve(uncompressedsize);
+	bool rc = false;
 
-	if(data == NULL) {
-		free(uncompressed);
+#ifdef HAVE_ZLIB
+	if(codec == CodecZlib) {
+		uLongf length = uncompressedsize;
+		rc = (::uncompress(buffer + HeaderLength, &length, getPayload(), getPayloadLength()) == Z_OK && length == uncompressedsize);
+	}
+#endif
+
+#ifdef HAVE_LZ4
+	if(codec == CodecLZ4) {
+		int length = LZ4_decompress_safe((const char*)getPayload(), (char*)(buffer + HeaderLength), getPayloadLength(), uncompressedsize);
+		rc = (length >= 0 && (uint32_t)length == uncompressedsize);
+	}
+#endif
+
+	if(!rc) {
+		MsgPool::release(buffer, size);
 		return false;
 	}
 
-	memcpy(data, uncompressed, uncompressedsize);
-	free(uncompressed);
+	memcpy(buffer, m_packet, HeaderLength);
+	releaseBuffer();
+
+	m_packet = buffer;
+	m_size = size;
+	m_usage = HeaderLength + uncompressedsize;
+	m_readposition = HeaderLength;
 
 	writePacket<uint32_t>(UncompressedPayloadLengthPos, htobe32(0));
 
@@ -680,7 +866,6 @@ bool MsgPacket::uncompress() {
 	freeze();
 
 	return true;
-#endif
 }
 
 void MsgPacket::print() {
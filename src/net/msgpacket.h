@@ -7,7 +7,7 @@
 #define MSGPACKET_H
 
 #include <stdint.h>
-#include <pthread.h>
+#include <stddef.h>
 #include <string.h>
 
 #include <ostream>
@@ -27,6 +27,86 @@
 // 24     uint32_t   uncompressed payload length (indicates compression if > 0)
 // 28     uint32_t   header checksum
 
+/**
+	@short Reference counted payload buffer
+
+	A payload buffer which can be attached to one or more packets without copying
+	the data into the packet buffers. The buffer is released with the last reference.
+*/
+
+class MsgPayload {
+public:
+
+	/**
+	Create payload buffer.
+	Allocates a new payload buffer with an initial reference count of 1.
+
+	@param	length		size of the buffer in bytes
+	@return pointer to the new buffer or NULL on memory allocation error
+	*/
+	static MsgPayload* create(uint32_t length);
+
+	/**
+	Wrap existing data.
+	Creates a payload buffer referencing (borrowing) external data. The data
+	isn't copied and must stay valid until the last reference is dropped.
+
+	@param	data		pointer to the data
+	@param	length		size of the data in bytes
+	@return pointer to the new buffer (reference count of 1)
+	*/
+	static MsgPayload* wrap(uint8_t* data, uint32_t length);
+
+	/**
+	Add reference.
+
+	@return pointer to the buffer
+	*/
+	MsgPayload* ref();
+
+	/**
+	Drop reference.
+	Releases the buffer if this was the last reference.
+	*/
+	void unref();
+
+	/**
+	Get pointer to the buffer data.
+
+	@return pointer to the data
+	*/
+	uint8_t* data() { return m_data; }
+
+	/**
+	Get buffer length.
+
+	@return size of the buffer in bytes
+	*/
+	uint32_t length() { return m_length; }
+
+	/**
+	Check for shared buffer.
+
+	@return true if the buffer has more than one reference
+	*/
+	bool shared() { return (m_refcount > 1); }
+
+	static void* operator new(size_t size);
+
+	static void operator delete(void* p, size_t size);
+
+private:
+
+	MsgPayload(uint8_t* data, uint32_t length, uint32_t capacity);
+
+	~MsgPayload();
+
+	uint8_t* m_data;
+	uint32_t m_length;
+	uint32_t m_capacity;
+	int m_refcount;
+};
+
 /**
 	@short Message Packet class
 
@@ -34,7 +114,11 @@
 	A packet consist of a header and a payload part
 */
 
+class MsgReader;
+
 class MsgPacket {
+	friend class MsgReader;
+
 public:
 
 	/**
@@ -44,8 +128,9 @@ public:
 	@param	msgid			user defined message id
 	@param	type			user defined message type (default: 0)
 	@param	uid				packet uid (default: unique incremental id)
+	@param	capacity		expected payload size in bytes (default: 0)
 	*/
-	MsgPacket(uint16_t msgid, uint16_t type = 0, uint32_t uid = 0);
+	MsgPacket(uint16_t msgid, uint16_t type = 0, uint32_t uid = 0, uint32_t capacity = 0);
 
 	/**
 	MsgPacket constructor.
@@ -58,6 +143,10 @@ public:
 	*/
 	~MsgPacket();
 
+	static void* operator new(size_t size);
+
+	static void operator delete(void* p, size_t size);
+
 	/**
 	Insert NULL terminated string.
 	Add a NULL terminted string to the payload of the packet.
@@ -140,6 +229,17 @@ public:
 	*/
 	bool put_Blob(uint8_t source[], uint32_t length);
 
+	/**
+	Attach an external payload buffer.
+	Appends the data of a payload buffer (by reference) to the payload of the packet.
+	The packet holds its own reference on the buffer. Packets with an attached buffer
+	are written with a single vectored write. No other data may be added after attaching.
+
+	@param	payload		payload buffer
+	@return true on success / false if a buffer is already attached
+	*/
+	bool attach(MsgPayload* payload);
+
 	/**
 	Reserve space.
 	Creates a memory region in the payload of the packet.
@@ -400,12 +500,15 @@ public:
 
 	/**
 	Compress packet.
-	Compress the payload of the packet
+	Compress the payload of the packet. The payload is compressed directly into a new
+	buffer which replaces the packet buffer. The packet is left untouched if the payload
+	doesn't shrink.
 
 	@param level compression level (1 - 9)
+	@param codec compression codec (default: zlib)
 	@return true on success
 	*/
-	bool compress(int level);
+	bool compress(int level, int codec = CodecZlib);
 
 	bool isCompressed();
 
@@ -413,21 +516,43 @@ public:
 	Uncompress packet.
 	Uncompress the payload of the packet
 
+	@param codec compression codec the packet has been compressed with (default: zlib)
 	@return true on success
 	*/
-	bool uncompress();
+	bool uncompress(int codec = CodecZlib);
+
+	/**
+	Check codec availability.
+
+	@param codec compression codec
+	@return true if the codec has been compiled in
+	*/
+	static bool codecSupported(int codec);
 
 	void print();
 
 	/**
 	Write packet to socket.
-	Writes the packet data to a filedescriptor
+	Writes the packet data (and an attached payload buffer) to a filedescriptor
 
 	@param	fd		filedescriptor of the socket
 	@param	timeout_ms	write operation timeout in milliseconds
 	*/
 	bool write(int fd, int timeout_ms = 3000);
 
+	/**
+	Write multiple packets to socket.
+	Writes a batch of packets with as few vectored writes as possible (corked until
+	the last packet has been passed to the socket)
+
+	@param	fd			filedescriptor of the socket
+	@param	packets		array of packets
+	@param	count		number of packets in the array
+	@param	timeout_ms	write operation timeout in milliseconds
+	@return true on success
+	*/
+	static bool write(int fd, MsgPacket** packets, int count, int timeout_ms = 3000);
+
 	/**
 	Receive packet from socket.
 	Create a new packet from incoming socket data
@@ -449,8 +574,33 @@ public:
 	*/
 	static MsgPacket* read(int fd, bool& closed, int timeout_ms = 3000);
 
+	/**
+	Copy packet to memory.
+	Copies the packet data (and an attached payload buffer) into a memory region.
+
+	@param	data	destination (must hold getPacketLength() bytes)
+	@return number of bytes copied
+	*/
+	uint32_t copyTo(uint8_t* data);
+
+	/**
+	Create packet from memory.
+	Creates a new packet from packet data previously stored with copyTo().
+
+	@param	data	pointer to the packet data
+	@param	length	length of the packet data
+	@return pointer to new packet or NULL if the data doesn't hold a valid packet
+	*/
+	static MsgPacket* create(const uint8_t* data, uint32_t length);
+
 	static bool readstream(std::istream& in, MsgPacket& p);
 
+	enum {
+		CodecZlib = 0,							/*!< zlib (deflate) compression */
+		CodecLZ4 = 1,							/*!< LZ4 compression (fast) */
+		CodecNone = 0xFF						/*!< no compression available */
+	};
+
 	enum {
 		HeaderLength = 32,						/*!< Length (in bytes) of a packet header. */
 		CheckSumPos = 28,						/*!< Checksum position (uint32_t) within the header data. */
@@ -467,7 +617,7 @@ public:
 
 protected:
 
-	void Init(uint16_t msgid, uint16_t type = 0, uint32_t uid = 0);
+	void Init(uint16_t msgid, uint16_t type = 0, uint32_t uid = 0, uint32_t capacity = 0);
 
 	/**
 	Set unique message id.
@@ -490,6 +640,8 @@ protected:
 
 private:
 
+	MsgPacket(uint8_t* data, uint32_t length, MsgPayload* buffer);
+
 	template<typename T>
 	void writePacket(int pos, T value) {
 		memcpy((void*)&m_packet[pos], (void*)&value, sizeof(T));
@@ -504,23 +656,27 @@ private:
 
 	bool checkPacketSize(uint32_t bytes);
 
+	void flatten();
+
+	void releaseBuffer();
+
 	static uint32_t globalUID;
-	static uint32_t crc32_tab[];
 
 	uint8_t* m_packet;
 	uint32_t m_size;
 	uint32_t m_usage;
 	uint32_t m_readposition;
 
+	MsgPayload* m_external;
+	MsgPayload* m_buffer;
+
 	bool m_freezed;
 	bool m_payloadchecksum;
 
 	enum {
 		InitialPacketSize = 128,
-		IncrementPacketSize = 512
+		WriteBatchSize = 64
 	};
-
-	static pthread_mutex_t uidmutex;
 };
 
 inline std::ostream& operator<<(std::ostream& out, MsgPacket& p) {
@@ -556,6 +712,7 @@ class MsgPacket {
 +bool put_U64(uint64_t ull)
 +bool put_S64(int64_t ll)
 +bool put_Blob(uint8_t source[], uint32_t length)
++bool attach(MsgPayload* payload)
 .. data getters ..
 +const char* get_String()
 +uint8_t get_U8()
@@ -571,17 +728,23 @@ class MsgPacket {
 +uint8_t* consume(uint32_t length)
 +void clear()
 .. compression ..
-+bool compress(int level)
-+bool uncompress()
++bool compress(int level, int codec)
++bool uncompress(int codec)
++{static} bool codecSupported(int codec)
 .. transport ..
 +{static} MsgPacket* read(int fd, bool& closed, int timeout_ms)
 +bool write(int fd, int timeout_ms)
++{static} bool write(int fd, MsgPacket** packets, int count, int timeout_ms)
++uint32_t copyTo(uint8_t* data)
++{static} MsgPacket* create(const uint8_t* data, uint32_t length)
 --
 -{static} uint32_t globalUID
 -uint8_t* m_packet;
 -uint32_t m_size;
 -uint32_t m_usage;
 -uint32_t m_readposition;
+-MsgPayload* m_external;
+-MsgPayload* m_buffer;
 }
 @enduml
 */
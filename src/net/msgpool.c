@@ -0,0 +1,177 @@
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "msgpool.h"
+
+static pthread_key_t cachekey;
+static pthread_once_t cacheonce = PTHREAD_ONCE_INIT;
+
+static pthread_mutex_t depotmutex = PTHREAD_MUTEX_INITIALIZER;
+static uint8_t* depot[MsgPool::ClassCount][MsgPool::DepotSize];
+static int depotcount[MsgPool::ClassCount];
+
+uint32_t MsgPool::capacity(uint32_t size) {
+	int cls = sizeClass(size);
+
+	if(cls < 0) {
+		return size;
+	}
+
+	return (1U << (cls + MinClassShift));
+}
+
+int MsgPool::sizeClass(uint32_t size) {
+	if(size > (1U << MaxClassShift)) {
+		return -1;
+	}
+
+	if(size <= (1U << MinClassShift)) {
+		return 0;
+	}
+
+	// index of the next power of two
+	return (32 - __builtin_clz(size - 1)) - MinClassShift;
+}
+
+int MsgPool::threadLimit(int cls) {
+	int limit = ThreadCacheBytes >> (cls + MinClassShift);
+
+	if(limit > ThreadCacheSize) {
+		return ThreadCacheSize;
+	}
+
+	return (limit < 2) ? 2 : limit;
+}
+
+int MsgPool::depotLimit(int cls) {
+	int limit = DepotBytes >> (cls + MinClassShift);
+
+	if(limit > DepotSize) {
+		return DepotSize;
+	}
+
+	return (limit < 4) ? 4 : limit;
+}
+
+void MsgPool::createKey() {
+	pthread_key_create(&cachekey, destroyCache);
+}
+
+MsgPool::ThreadCache* MsgPool::threadCache() {
+	pthread_once(&cacheonce, createKey);
+
+	ThreadCache* cache = (ThreadCache*)pthread_getspecific(cachekey);
+
+	if(cache != NULL) {
+		return cache;
+	}
+
+	cache = (ThreadCache*)calloc(1, sizeof(ThreadCache));
+
+	if(cache != NULL) {
+		pthread_setspecific(cachekey, cache);
+	}
+
+	return cache;
+}
+
+void MsgPool::destroyCache(void* p) {
+	ThreadCache* cache = (ThreadCache*)p;
+
+	for(int cls = 0; cls < ClassCount; cls++) {
+		flushCache(cache, cls, cache->count[cls]);
+	}
+
+	free(cache);
+}
+
+void MsgPool::fillCache(ThreadCache* cache, int cls) {
+	int want = threadLimit(cls) / 2;
+
+	if(want < 1) {
+		want = 1;
+	}
+
+	pthread_mutex_lock(&depotmutex);
+
+	while(want-- > 0 && depotcount[cls] > 0) {
+		cache->buffer[cls][cache->count[cls]++] = depot[cls][--depotcount[cls]];
+	}
+
+	pthread_mutex_unlock(&depotmutex);
+}
+
+void MsgPool::flushCache(ThreadCache* cache, int cls, int count) {
+	int limit = depotLimit(cls);
+	int moved = 0;
+
+	pthread_mutex_lock(&depotmutex);
+
+	while(moved < count && depotcount[cls] < limit) {
+		depot[cls][depotcount[cls]++] = cache->buffer[cls][--cache->count[cls]];
+		moved++;
+	}
+
+	pthread_mutex_unlock(&depotmutex);
+
+	// depot is full, drop the remaining buffers
+	while(moved++ < count) {
+		free(cache->buffer[cls][--cache->count[cls]]);
+	}
+}
+
+uint8_t* MsgPool::alloc(uint32_t& size) {
+	int cls = sizeClass(size);
+
+	if(cls < 0) {
+		return (uint8_t*)malloc(size);
+	}
+
+	size = (1U << (cls + MinClassShift));
+
+	ThreadCache* cache = threadCache();
+
+	if(cache == NULL) {
+		return (uint8_t*)malloc(size);
+	}
+
+	if(cache->count[cls] == 0) {
+		fillCache(cache, cls);
+	}
+
+	if(cache->count[cls] > 0) {
+		return cache->buffer[cls][--cache->count[cls]];
+	}
+
+	return (uint8_t*)malloc(size);
+}
+
+void MsgPool::release(uint8_t* buffer, uint32_t size) {
+	if(buffer == NULL) {
+		return;
+	}
+
+	int cls = sizeClass(size);
+
+	// only exact size classes are pooled
+	if(cls < 0 || size != (1U << (cls + MinClassShift))) {
+		free(buffer);
+		return;
+	}
+
+	ThreadCache* cache = threadCache();
+
+	if(cache == NULL) {
+		free(buffer);
+		return;
+	}
+
+	int limit = threadLimit(cls);
+
+	// move half of the cache to the depot
+	if(cache->count[cls] >= limit) {
+		flushCache(cache, cls, limit / 2);
+	}
+
+	cache->buffer[cls][cache->count[cls]++] = buffer;
+}
@@ -0,0 +1,103 @@
+/** \file msgpool.h
+	Header file for the MsgPool class.
+	This include file defines the MsgPool buffer allocator
+*/
+
+#ifndef MSGPOOL_H
+#define MSGPOOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+	@short Size-class buffer pool
+
+	Allocator for packet and payload buffers. Requests are rounded up to power-of-two
+	size classes (128 bytes - 2 MB). Released buffers are kept in a small per-thread
+	cache and are exchanged in batches with a global depot, so a thread allocating
+	buffers (e.g. a demuxer) and a thread releasing them (e.g. a socket writer) reach
+	a steady state without touching the heap. Larger requests bypass the pool.
+*/
+
+class MsgPool {
+public:
+
+	/**
+	Allocate buffer.
+	Returns a buffer of at least "size" bytes.
+
+	@param	size		requested size in bytes. set to the usable capacity of the buffer on return
+	@return pointer to the buffer or NULL on memory allocation error
+	*/
+	static uint8_t* alloc(uint32_t& size);
+
+	/**
+	Release buffer.
+	Returns a buffer to the pool.
+
+	@param	buffer		pointer to the buffer (may be NULL)
+	@param	size		capacity of the buffer (as returned by alloc)
+	*/
+	static void release(uint8_t* buffer, uint32_t size);
+
+	/**
+	Get allocation size.
+	Returns the capacity a request of "size" bytes will be rounded up to.
+
+	@param	size		requested size in bytes
+	@return capacity of the buffer
+	*/
+	static uint32_t capacity(uint32_t size);
+
+	enum {
+		MinClassShift = 7,						/*!< smallest size class (128 bytes) */
+		MaxClassShift = 21,						/*!< largest size class (2 MB) */
+		ClassCount = MaxClassShift - MinClassShift + 1,
+		ThreadCacheSize = 32,					/*!< maximum number of cached buffers per class and thread */
+		ThreadCacheBytes = 4 * 1024 * 1024,		/*!< maximum number of cached bytes per class and thread */
+		DepotSize = 128,						/*!< maximum number of buffers per class in the global depot */
+		DepotBytes = 16 * 1024 * 1024			/*!< maximum number of bytes per class in the global depot */
+	};
+
+private:
+
+	struct ThreadCache {
+		uint8_t* buffer[ClassCount][ThreadCacheSize];
+		int count[ClassCount];
+	};
+
+	static int sizeClass(uint32_t size);
+
+	static int threadLimit(int cls);
+
+	static int depotLimit(int cls);
+
+	static ThreadCache* threadCache();
+
+	static void createKey();
+
+	static void destroyCache(void* cache);
+
+	static void fillCache(ThreadCache* cache, int cls);
+
+	static void flushCache(ThreadCache* cache, int cls, int count);
+};
+
+/*
+@startuml
+
+class MsgPool {
+.. memory allocation ..
++{static} uint8_t* alloc(uint32_t& size)
++{static} void release(uint8_t* buffer, uint32_t size)
++{static} uint32_t capacity(uint32_t size)
+--
+-{static} ThreadCache* threadCache()
+-{static} void fillCache(ThreadCache* cache, int cls)
+-{static} void flushCache(ThreadCache* cache, int cls, int count)
+}
+
+@enduml
+*/
+
+#endif // MSGPOOL_H
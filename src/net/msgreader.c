@@ -0,0 +1,198 @@
+#include <string.h>
+#include <iostream>
+#include <unistd.h>
+
+#include "os-config.h"
+#include "msgpacket.h"
+#include "msgreader.h"
+#include "crc32.h"
+
+MsgReader::MsgReader(int fd, uint32_t buffersize) : m_fd(fd), m_start(0), m_end(0), m_needed(MsgPacket::HeaderLength) {
+	m_buffer = MsgPayload::create(buffersize);
+}
+
+MsgReader::~MsgReader() {
+	if(m_buffer != NULL) {
+		m_buffer->unref();
+	}
+}
+
+uint32_t MsgReader::buffered() {
+	return m_end - m_start;
+}
+
+void MsgReader::reset() {
+	m_start = 0;
+	m_end = 0;
+	m_needed = MsgPacket::HeaderLength;
+
+	// packets still reference the buffer
+	if(m_buffer != NULL && m_buffer->shared()) {
+		uint32_t size = m_buffer->length();
+		m_buffer->unref();
+		m_buffer = MsgPayload::create(size);
+	}
+}
+
+bool MsgReader::reserve(uint32_t length) {
+	if(m_buffer == NULL) {
+		return false;
+	}
+
+	uint32_t pending = m_end - m_start;
+	uint32_t capacity = m_buffer->length();
+
+	// enough room behind the pending data
+	if(m_start + length <= capacity && m_end < capacity) {
+		return true;
+	}
+
+	if(length < capacity) {
+		length = capacity;
+	}
+
+	// move pending data to the front of a new buffer (copy on write)
+	if(m_buffer->shared() || length > capacity) {
+		MsgPayload* buffer = MsgPayload::create(length);
+
+		if(buffer == NULL) {
+			return false;
+		}
+
+		memcpy(buffer->data(), m_buffer->data() + m_start, pending);
+		m_buffer->unref();
+		m_buffer = buffer;
+	}
+	// move pending data to the front of the buffer
+	else {
+		memmove(m_buffer->data(), m_buffer->data() + m_start, pending);
+	}
+
+	m_start = 0;
+	m_end = pending;
+
+	return true;
+}
+
+int MsgReader::fill(int timeout_ms) {
+	uint8_t* data = m_buffer->data() + m_end;
+	uint32_t length = m_buffer->length() - m_end;
+
+	for(;;) {
+		int rc = recv(m_fd, (char*)data, length, MSG_DONTWAIT);
+
+		if(rc == -1 && sockerror() == ENOTSOCK) {
+			rc = ::read(m_fd, data, length);
+		}
+
+		if(rc == 0) {
+			return ECONNRESET;
+		}
+
+		if(rc > 0) {
+			m_end += rc;
+			return 0;
+		}
+
+		if(sockerror() != SEWOULDBLOCK && sockerror() != EINTR) {
+			return sockerror();
+		}
+
+		// only wait if there isn't any data available
+		if(!pollfd(m_fd, timeout_ms, true)) {
+			return ETIMEDOUT;
+		}
+	}
+}
+
+MsgPacket* MsgReader::parse() {
+	m_needed = MsgPacket::HeaderLength;
+
+	while(m_end - m_start >= (uint32_t)MsgPacket::HeaderLength) {
+		uint8_t* data = m_buffer->data() + m_start;
+		uint32_t pending = m_end - m_start;
+		uint32_t value;
+
+		// try to find sync
+		memcpy(&value, data + MsgPacket::SyncPos, sizeof(value));
+
+		if(be32toh(value) != 0xAAAAAA) {
+			uint8_t* sync = (uint8_t*)memchr(data + 1, 0x00, pending - 1);
+			m_start = (sync == NULL) ? m_end : (sync - m_buffer->data());
+			continue;
+		}
+
+		// header validation
+		memcpy(&value, data + MsgPacket::CheckSumPos, sizeof(value));
+
+		if(be32toh(value) != CRC32::checksum(data, MsgPacket::CheckSumPos)) {
+			std::cerr << "checksum failed !" << std::endl;
+			m_start++;
+			continue;
+		}
+
+		memcpy(&value, data + MsgPacket::PayloadLengthPos, sizeof(value));
+		uint32_t payloadlength = be32toh(value);
+
+		// bogus payload length (may overflow or exhaust memory)
+		if(payloadlength > (uint32_t)MaxPayloadLength) {
+			std::cerr << "payload too large !" << std::endl;
+			m_start++;
+			continue;
+		}
+
+		uint32_t length = MsgPacket::HeaderLength + payloadlength;
+
+		// wait for the complete packet
+		if(pending < length) {
+			m_needed = length;
+			return NULL;
+		}
+
+		m_start += length;
+
+		MsgPacket* p = new MsgPacket(data, length, m_buffer);
+
+		// payload checksum validation
+		uint32_t plcs = p->getPayloadCheckSum();
+		p->m_payloadchecksum = (plcs != 0);
+
+		if(p->m_payloadchecksum && plcs != CRC32::checksum(data + MsgPacket::HeaderLength, length - MsgPacket::HeaderLength)) {
+			std::cerr << "wrong payload checksum !" << std::endl;
+			delete p;
+			continue;
+		}
+
+		return p;
+	}
+
+	return NULL;
+}
+
+MsgPacket* MsgReader::read(int timeout_ms) {
+	bool closed;
+	return read(closed, timeout_ms);
+}
+
+MsgPacket* MsgReader::read(bool& closed, int timeout_ms) {
+	closed = false;
+
+	for(;;) {
+		MsgPacket* p = parse();
+
+		if(p != NULL) {
+			return p;
+		}
+
+		if(!reserve(m_needed)) {
+			return NULL;
+		}
+
+		int rc = fill(timeout_ms);
+
+		if(rc != 0) {
+			closed = (rc == ECONNRESET);
+			return NULL;
+		}
+	}
+}
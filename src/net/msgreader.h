@@ -0,0 +1,116 @@
+/** \file msgreader.h
+	Header file for the MsgReader class.
+	This include file defines the buffered MsgPacket reader
+*/
+
+#ifndef MSGREADER_H
+#define MSGREADER_H
+
+#include <stdint.h>
+
+class MsgPacket;
+class MsgPayload;
+
+/**
+	@short Buffered packet reader
+
+	Reads as much data as available from a filedescriptor (socket or file) into
+	a receive buffer and parses any number of complete packets out of it.
+	Packets returned by the reader reference the receive buffer without copying
+	the data. The buffer is only reused once all packets referencing it have been
+	deleted (a new buffer is used otherwise).
+*/
+
+class MsgReader {
+public:
+
+	/**
+	MsgReader constructor.
+
+	@param	fd			filedescriptor of the socket or file
+	@param	buffersize	initial size of the receive buffer
+	*/
+	MsgReader(int fd, uint32_t buffersize = DefaultBufferSize);
+
+	/**
+	Destructor.
+	*/
+	~MsgReader();
+
+	/**
+	Receive packet.
+	Returns the next buffered packet or reads more data until a complete packet
+	is available.
+
+	@param	closed		set to true if connection has been closed (end of file)
+	@param	timeout_ms	read operation timeout in milliseconds
+	@return pointer to new packet or NULL on timeout
+	*/
+	MsgPacket* read(bool& closed, int timeout_ms = 3000);
+
+	/**
+	Receive packet.
+
+	@param	timeout_ms	read operation timeout in milliseconds
+	@return pointer to new packet or NULL on timeout
+	*/
+	MsgPacket* read(int timeout_ms = 3000);
+
+	/**
+	Get number of buffered bytes.
+	Returns the number of bytes which have been read from the filedescriptor but
+	haven't been returned as packets yet.
+
+	@return number of buffered bytes
+	*/
+	uint32_t buffered();
+
+	/**
+	Discard buffered data.
+	Must be called after the filedescriptor has been repositioned.
+	*/
+	void reset();
+
+	enum {
+		DefaultBufferSize = 64 * 1024,
+		MaxPayloadLength = 8 * 1024 * 1024		/*!< packets with a larger payload are rejected */
+	};
+
+private:
+
+	MsgPacket* parse();
+
+	bool reserve(uint32_t length);
+
+	int fill(int timeout_ms);
+
+	int m_fd;
+
+	MsgPayload* m_buffer;
+
+	uint32_t m_start;
+
+	uint32_t m_end;
+
+	uint32_t m_needed;
+};
+
+/*
+@startuml
+
+class MsgReader {
+.. transport ..
++MsgPacket* read(bool& closed, int timeout_ms)
++uint32_t buffered()
++void reset()
+--
+-int m_fd
+-MsgPayload* m_buffer
+-uint32_t m_start
+-uint32_t m_end
+}
+
+@enduml
+*/
+
+#endif // MSGREADER_H
@@ -1,8 +1,14 @@
 #include "os-config.h"
 #include <unistd.h>
 #include <stdio.h>
+#include <string.h>
+#include <limits.h>
 #include <arpa/inet.h>
 
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
 // WINDOWS
 
 #ifdef WIN32
@@ -106,6 +112,87 @@ int socketread(int fd, uint8_t* data, int datalen, int timeout_ms) {
         return 0;
 }
 
+// write a vector of buffers. the iovec array is modified on partial writes.
+// the socket is only polled if it would block.
+
+int socketwritev(int fd, struct iovec* iov, int iovcnt, int timeout_ms, bool more) {
+#ifdef WIN32
+	for(int i = 0; i < iovcnt; i++) {
+		uint8_t* data = (uint8_t*)iov[i].iov_base;
+		size_t written = 0;
+
+		while(written < iov[i].iov_len) {
+			if(pollfd(fd, timeout_ms, false) == 0) {
+				return ETIMEDOUT;
+			}
+
+			int rc = send(fd, (sendval_t*)(data + written), iov[i].iov_len - written, 0);
+
+			if(rc == -1) {
+				if(sockerror() == SEWOULDBLOCK) {
+					continue;
+				}
+
+				return sockerror();
+			}
+
+			written += rc;
+		}
+	}
+
+	return 0;
+#else
+	struct msghdr msg;
+
+	while(iovcnt > 0) {
+		int count = (iovcnt > IOV_MAX) ? IOV_MAX : iovcnt;
+		int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+
+		// more data will follow (cork)
+		if(more || count < iovcnt) {
+			flags |= MSG_MORE;
+		}
+
+		memset(&msg, 0, sizeof(msg));
+		msg.msg_iov = iov;
+		msg.msg_iovlen = count;
+
+		ssize_t rc = sendmsg(fd, &msg, flags);
+
+		if(rc == -1 && sockerror() == ENOTSOCK) {
+			rc = ::writev(fd, iov, count);
+		}
+
+		if(rc == -1) {
+			if(sockerror() == SEWOULDBLOCK || sockerror() == EINTR) {
+				if(pollfd(fd, timeout_ms, false) == 0) {
+					return ETIMEDOUT;
+				}
+
+				continue;
+			}
+
+			return sockerror();
+		}
+
+		// skip completely written buffers
+		while(iovcnt > 0 && (size_t)rc >= iov->iov_len) {
+			rc -= iov->iov_len;
+			iov++;
+			iovcnt--;
+		}
+
+		// partially written buffer
+		if(iovcnt > 0) {
+			iov->iov_base = (uint8_t*)iov->iov_base + rc;
+			iov->iov_len -= rc;
+		}
+	}
+
+	return 0;
+#endif
+}
+
 char *xvdr_inet_ntoa(in6_addr addr)
 {
 	static char buff[INET6_ADDRSTRLEN];
@@ -16,6 +16,12 @@
 
 #define MSG_DONTWAIT 0
 #define MSG_NOSIGNAL 0
+#define MSG_MORE 0
+
+struct iovec {
+	void* iov_base;
+	size_t iov_len;
+};
 
 #include <iostream>
 #include <winsock2.h>
@@ -44,6 +50,7 @@ uint16_t be16toh(uint16_t u);
 
 #include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
 #include <netdb.h>
 #include <errno.h>
 #include <netinet/tcp.h>
@@ -67,4 +74,5 @@ uint16_t be16toh(uint16_t u);
 bool pollfd(int fd, int timeout_ms, bool in);
 bool setsock_nonblock(int fd, bool nonblock = true);
 int socketread(int fd, uint8_t* data, int datalen, int timeout_ms);
+int socketwritev(int fd, struct iovec* iov, int iovcnt, int timeout_ms, bool more = false);
 char *xvdr_inet_ntoa(in6_addr addr);
@@ -0,0 +1,106 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_MPSCQUEUE_H
+#define XVDR_MPSCQUEUE_H
+
+#include <stddef.h>
+
+// Unbounded multi-producer / single-consumer queue.
+// Push() is lock-free and may be called from any thread, Pop() must only
+// be called from one thread at a time. An item pushed concurrently to
+// Pop() may not be visible before the next call of Pop().
+
+template<class T>
+class cMPSCQueue
+{
+public:
+
+  cMPSCQueue()
+  {
+    m_head = m_tail = new Node;
+  }
+
+  ~cMPSCQueue()
+  {
+    while(m_tail != NULL)
+    {
+      Node* next = m_tail->next;
+      delete m_tail;
+      m_tail = next;
+    }
+  }
+
+  void Push(const T& value)
+  {
+    Node* node = new Node;
+    node->value = value;
+
+    // publish the node, then link it to its predecessor
+    Node* prev = __sync_lock_test_and_set(&m_head, node);
+    __sync_synchronize();
+    prev->next = node;
+  }
+
+  bool Pop(T& value)
+  {
+    Node* tail = m_tail;
+    Node* next = tail->next;
+
+    if(next == NULL)
+      return false;
+
+    __sync_synchronize();
+
+    value = next->value;
+    m_tail = next;
+    delete tail;
+
+    return true;
+  }
+
+  bool Empty()
+  {
+    return (m_tail->next == NULL);
+  }
+
+private:
+
+  struct Node
+  {
+    Node() : next(NULL) {}
+    Node* volatile next;
+    T value;
+  };
+
+  Node* volatile m_head;
+
+  Node* m_tail;
+
+  // non-copyable
+  cMPSCQueue(const cMPSCQueue&);
+  cMPSCQueue& operator=(const cMPSCQueue&);
+};
+
+#endif // XVDR_MPSCQUEUE_H
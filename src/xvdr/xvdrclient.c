@@ -28,7 +28,10 @@
 #include <sys/socket.h>
 #include <unistd.h>
 #include <sys/types.h>
+#include <time.h>
+#include <algorithm>
 #include <map>
+#include <set>
 #include <string>
 
 #include <vdr/recording.h>
@@ -42,18 +45,23 @@
 #include <vdr/sources.h>
 
 #include "config/config.h"
+#include "demuxer/demuxer.h"
 #include "live/livestreamer.h"
 #include "net/msgpacket.h"
+#include "net/msgreader.h"
 #include "recordings/recordingscache.h"
 #include "recordings/recplayer.h"
 #include "tools/hash.h"
+#include "tools/mpscqueue.h"
 #include "tools/urlencode.h"
 
 #include "xvdr/xvdrchannels.h"
 
 #include "xvdrcommand.h"
 #include "xvdrclient.h"
+#include "xvdrwriter.h"
 #include "xvdrserver.h"
+#include "xvdrworker.h"
 #include "timerconflicts.h"
 
 
@@ -163,18 +171,23 @@ cXVDRClient::cXVDRClient(int fd, unsigned int id)
   m_req                     = NULL;
   m_resp                    = NULL;
   m_compressionLevel        = 0;
+  m_compressionCodec        = MsgPacket::CodecZlib;
+  m_payloadCheckSum         = true;
   m_LanguageIndex           = -1;
   m_LangStreamType          = cStreamInfo::stMPEG2AUDIO;
   m_channelCount            = 0;
   m_timeout                 = 3000;
   m_scanSupported           = false;
+  m_closed                  = false;
+  m_workerPool              = NULL;
+  m_channelsChanged         = 0;
 
   m_socket = fd;
+  m_reader = new MsgReader(fd);
+  m_writer = new cXVDRWriter(fd, id);
   m_wantfta = true;
   m_filterlanguage = false;
 
-  Start();
-
   m_scanSupported = m_scanner.Connect();
 }
 
@@ -183,9 +196,11 @@ cXVDRClient::~cXVDRClient()
   DEBUGLOG("%s", __FUNCTION__);
   StopChannelStreaming();
 
+  // stop sending (pending messages are discarded)
+  delete m_writer;
+
   // shutdown connection
   shutdown(m_socket, SHUT_RDWR); 
-  Cancel(10);
 
   // close connection
   close(m_socket);
@@ -193,77 +208,84 @@ cXVDRClient::~cXVDRClient()
   // remove recplayer
   delete m_RecPlayer;
 
-  // delete messagequeue
-  {
-    cMutexLock lock(&m_queueLock);
-    while(!m_queue.empty()) {
-      MsgPacket* p = m_queue.front();
-      m_queue.pop();
-      delete p;
-    }
+  delete m_reader;
+
+  MsgPacket* notification = NULL;
+  while(m_notifications.Pop(notification)) {
+    delete notification;
   }
 
   DEBUGLOG("done");
 }
 
-void cXVDRClient::Action(void)
+bool cXVDRClient::Process()
 {
   bool bClosed(false);
 
-  // only root may change the priority
-  if(geteuid() == 0) {
-    SetPriority(10);
-  }
-
-  while (Running()) {
+  // handle all requests received so far
+  while((m_req = m_reader->read(bClosed, 0)) != NULL) {
 
-    // send pending messages
-    {
-      cMutexLock lock(&m_queueLock);
+    // don't let bulk queries block subsequent requests
+    if(m_loggedIn && IsAsyncRequest(m_req->getMsgID()) && m_workerPool != NULL && m_workerPool->Execute(this, m_req)) {
+      m_req = NULL;
+      continue;
+    }
 
-      while(!m_queue.empty()) {
-        MsgPacket* p = m_queue.front();
+    processRequest();
+    delete m_req;
+    m_req = NULL;
+  }
 
-        if(!p->write(m_socket, m_timeout)) {
-          break;
-        }
+  if(bClosed) {
+    /* connection has been closed, delete a
+       possible running stream here */
+    StopChannelStreaming();
+    m_closed = true;
 
-        m_queue.pop();
-        delete p;
-      }
-    }
+    return false;
+  }
 
-    m_req = MsgPacket::read(m_socket, bClosed, 1000);
+  // pending status notifications
+  if(__sync_lock_test_and_set(&m_channelsChanged, 0)) {
+    SendChannelsChanged();
+  }
 
-    if(bClosed) {
-      delete m_req;
-      m_req = NULL;
-      break;
-    }
+  MsgPacket* notification = NULL;
+  while(m_notifications.Pop(notification)) {
+    QueueMessage(notification);
+  }
 
-    if(m_req != NULL) {
-      processRequest();
-      delete m_req;
-    }
-    else if(m_scanner.IsScanning()) {
-      SendScannerStatus();
-    }
+  if(m_scanner.IsScanning() && m_scanTimer.TimedOut()) {
+    SendScannerStatus();
+    m_scanTimer.Set(1000);
   }
 
-  /* If thread is ended due to closed connection delete a
-     possible running stream here */
-  StopChannelStreaming();
+  return true;
+}
+
+bool cXVDRClient::HasPendingWork()
+{
+  // scanner status is polled
+  return m_scanner.IsScanning();
 }
 
-int cXVDRClient::StartChannelStreaming(const cChannel *channel, uint32_t timeout, int32_t priority, bool waitforiframe)
+int cXVDRClient::StartChannelStreaming(const cChannel *channel, uint32_t timeout, int32_t priority, bool waitforiframe, bool rawts)
 {
   cMutexLock lock(&m_streamerLock);
 
-  m_Streamer = new cLiveStreamer(this, channel, priority);
+  // reuse the running streamer (queue and receiver thread)
+  if(m_Streamer != NULL) {
+    m_Streamer->Retune(channel, priority);
+  }
+  else {
+    m_Streamer = new cLiveStreamer(this, channel, priority);
+  }
+
   m_Streamer->SetLanguage(m_LanguageIndex, m_LangStreamType);
   m_Streamer->SetTimeout(timeout);
   m_Streamer->SetProtocolVersion(m_protocolVersion);
   m_Streamer->SetWaitForIFrame(waitforiframe);
+  m_Streamer->SetRawTS(rawts);
 
   return XVDR_RET_OK;
 }
@@ -286,29 +308,25 @@ void cXVDRClient::TimerChange(const cTimer *Timer, eTimerChange Change)
   TimerChange();
 }
 
-void cXVDRClient::ChannelChange(const cChannel *Channel) {
-  cMutexLock lock(&m_streamerLock);
-
-  if(m_Streamer == NULL) {
-    return;
-  }
-
-  m_Streamer->ChannelChange(Channel);
-}
-
 void cXVDRClient::TimerChange()
 {
-  cMutexLock lock(&m_msgLock);
-
   if (m_StatusInterfaceEnabled)
   {
     INFOLOG("Sending timer change request to client #%i ...", m_Id);
     MsgPacket* resp = new MsgPacket(XVDR_STATUS_TIMERCHANGE, XVDR_CHANNEL_STATUS);
-    QueueMessage(resp);
+    Notify(resp);
   }
 }
 
 void cXVDRClient::ChannelsChanged()
+{
+  // channels are counted with the connection's filter settings
+  // when the client is processed next
+  __sync_lock_test_and_set(&m_channelsChanged, 1);
+  Wakeup();
+}
+
+void cXVDRClient::SendChannelsChanged()
 {
   cMutexLock lock(&m_msgLock);
 
@@ -333,19 +351,15 @@ void cXVDRClient::ChannelsChanged()
 
 void cXVDRClient::RecordingsChange()
 {
-  cMutexLock lock(&m_msgLock);
-
   if (!m_StatusInterfaceEnabled)
     return;
 
   MsgPacket* resp = new MsgPacket(XVDR_STATUS_RECORDINGSCHANGE, XVDR_CHANNEL_STATUS);
-  QueueMessage(resp);
+  Notify(resp);
 }
 
 void cXVDRClient::Recording(const cDevice *Device, const char *Name, const char *FileName, bool On)
 {
-  cMutexLock lock(&m_msgLock);
-
   if (m_StatusInterfaceEnabled)
   {
     MsgPacket* resp = new MsgPacket(XVDR_STATUS_RECORDING, XVDR_CHANNEL_STATUS);
@@ -362,14 +376,12 @@ void cXVDRClient::Recording(const cDevice *Device, const char *Name, const char
     else
       resp->put_String("");
 
-    QueueMessage(resp);
+    Notify(resp);
   }
 }
 
 void cXVDRClient::OsdStatusMessage(const char *Message)
 {
-  cMutexLock lock(&m_msgLock);
-
   if (m_StatusInterfaceEnabled && Message)
   {
     /* Ignore this messages */
@@ -404,7 +416,7 @@ void cXVDRClient::StatusMessage(const char *Message) {
   resp->put_U32(0);
   resp->put_String(Message);
 
-  QueueMessage(resp);
+  Notify(resp);
 }
 
 bool cXVDRClient::IsChannelWanted(cChannel* channel, int type)
@@ -542,6 +554,14 @@ bool cXVDRClient::processRequest()
       result = processChannelStream_Signal();
       break;
 
+    case XVDR_CHANNELSTREAM_SELECT:
+      result = processChannelStream_Select();
+      break;
+
+    case XVDR_CHANNELSTREAM_SEEK:
+      result = processChannelStream_Seek();
+      break;
+
     /** OPCODE 40 - 59: XVDR network functions for recording streaming */
     case XVDR_RECSTREAM_OPEN:
       result = processRecStream_Open();
@@ -617,7 +637,7 @@ bool cXVDRClient::processRequest()
       break;
 
     case XVDR_RECORDINGS_GETLIST:
-      result = processRECORDINGS_GetList();
+      result = processRECORDINGS_GetList(m_req, m_resp);
       break;
 
     case XVDR_RECORDINGS_RENAME:
@@ -647,7 +667,7 @@ bool cXVDRClient::processRequest()
 
     /** OPCODE 120 - 139: XVDR network functions for epg access and manipulating */
     case XVDR_EPG_GETFORCHANNEL:
-      result = processEPG_GetForChannel();
+      result = processEPG_GetForChannel(m_req, m_resp);
       break;
 
 
@@ -684,12 +704,59 @@ bool cXVDRClient::processRequest()
   {
     QueueMessage(m_resp);
   }
+  else
+  {
+    delete m_resp;
+  }
 
   m_resp = NULL;
 
   return result;
 }
 
+bool cXVDRClient::IsAsyncRequest(uint16_t msgid)
+{
+  // bulk queries which don't depend on (or modify) the connection state
+  switch(msgid)
+  {
+    case XVDR_RECORDINGS_GETLIST:
+    case XVDR_EPG_GETFORCHANNEL:
+      return true;
+
+    default:
+      return false;
+  }
+}
+
+bool cXVDRClient::processRequestAsync(MsgPacket* req)
+{
+  MsgPacket* resp = new MsgPacket(req->getMsgID(), XVDR_CHANNEL_REQUEST_RESPONSE, req->getUID());
+  resp->setProtocolVersion(XVDR_PROTOCOLVERSION);
+
+  bool result = false;
+  switch(req->getMsgID())
+  {
+    case XVDR_RECORDINGS_GETLIST:
+      result = processRECORDINGS_GetList(req, resp);
+      break;
+
+    case XVDR_EPG_GETFORCHANNEL:
+      result = processEPG_GetForChannel(req, resp);
+      break;
+
+    default:
+      break;
+  }
+
+  // responses are matched by the request UID
+  if(result)
+    QueueMessage(resp);
+  else
+    delete resp;
+
+  return result;
+}
+
 
 /** OPCODE 1 - 19: XVDR network functions for general purpose */
 
@@ -699,6 +766,8 @@ bool cXVDRClient::process_Login() /* OPCODE 1 */
   m_compressionLevel = m_req->get_U8();
   m_clientName = m_req->get_String();
   const char *language   = NULL;
+  bool checksumRequested = false;
+  bool codecRequested = false;
 
   // get preferred language
   if(!m_req->eop())
@@ -708,6 +777,30 @@ bool cXVDRClient::process_Login() /* OPCODE 1 */
     m_LangStreamType = (cStreamInfo::Type)m_req->get_U8();
   }
 
+  // payload checksums (may be disabled on trusted links)
+  if(!m_req->eop())
+  {
+    m_payloadCheckSum = (m_req->get_U8() != 0);
+    checksumRequested = true;
+  }
+
+  // compression codec (fall back to zlib if not available)
+  if(!m_req->eop())
+  {
+    m_compressionCodec = m_req->get_U8();
+    codecRequested = true;
+  }
+
+  if(!MsgPacket::codecSupported(m_compressionCodec))
+    m_compressionCodec = MsgPacket::CodecZlib;
+
+  // built without any codec
+  if(!MsgPacket::codecSupported(m_compressionCodec))
+  {
+    m_compressionCodec = MsgPacket::CodecNone;
+    m_compressionLevel = 0;
+  }
+
   if (m_protocolVersion > XVDR_PROTOCOLVERSION || m_protocolVersion < 4)
   {
     ERRORLOG("Client '%s' has unsupported protocol version '%u', terminating client", m_clientName.c_str(), m_protocolVersion);
@@ -731,6 +824,24 @@ bool cXVDRClient::process_Login() /* OPCODE 1 */
   m_resp->put_String("VDR-XVDR Server");
   m_resp->put_String(XVDR_VERSION);
 
+  if(checksumRequested)
+  {
+    INFOLOG("Payload checksums %s", m_payloadCheckSum ? "enabled" : "disabled");
+    m_resp->put_U8(m_payloadCheckSum);
+  }
+
+  if(codecRequested)
+  {
+    const char* codec = "zlib";
+    if(m_compressionCodec == MsgPacket::CodecLZ4)
+      codec = "lz4";
+    else if(m_compressionCodec == MsgPacket::CodecNone)
+      codec = "none";
+
+    INFOLOG("Compression codec: %s (level %i)", codec, m_compressionLevel);
+    m_resp->put_U8(m_compressionCodec);
+  }
+
   SetLoggedIn(true);
   return true;
 }
@@ -813,16 +924,11 @@ bool cXVDRClient::process_ChannelFilter()
 
 bool cXVDRClient::processChannelStream_Open() /* OPCODE 20 */
 {
-  cMutexLock lock(&m_timerLock);
-
-  // only root may change the priority
-  if(geteuid() == 0) {
-    SetPriority(-15);
-  }
-
+  // doesn't touch timers (m_timerLock would make it wait for other clients)
   uint32_t uid = m_req->get_U32();
   int32_t priority = 50;
   bool waitforiframe = false;
+  bool rawts = false;
 
   if(!m_req->eop()) {
     priority = m_req->get_S32();
@@ -832,9 +938,12 @@ bool cXVDRClient::processChannelStream_Open() /* OPCODE 20 */
     waitforiframe = m_req->get_U8();
   }
 
-  uint32_t timeout = XVDRServerConfig.stream_timeout;
+  // send the filtered transport stream instead of demuxed packets
+  if(!m_req->eop()) {
+    rawts = m_req->get_U8();
+  }
 
-  StopChannelStreaming();
+  uint32_t timeout = XVDRServerConfig.stream_timeout;
 
   XVDRChannels.Lock(false);
   const cChannel *channel = NULL;
@@ -850,11 +959,12 @@ bool cXVDRClient::processChannelStream_Open() /* OPCODE 20 */
 
   if (channel == NULL) {
     ERRORLOG("Can't find channel %08x", uid);
+    StopChannelStreaming();
     m_resp->put_U32(XVDR_RET_DATAINVALID);
   }
   else
   {
-    int status = StartChannelStreaming(channel, timeout, priority, waitforiframe);
+    int status = StartChannelStreaming(channel, timeout, priority, waitforiframe, rawts);
 
     if (status == XVDR_RET_OK) {
       INFOLOG("--------------------------------------");
@@ -878,8 +988,18 @@ bool cXVDRClient::processChannelStream_Close() /* OPCODE 21 */
 
 bool cXVDRClient::processChannelStream_Request() /* OPCODE 22 */
 {
+  // optional credit window (bytes / milliseconds of media),
+  // a single packet is sent without
+  uint32_t bytes = 0;
+  uint32_t ms = 0;
+
+  if(!m_req->eop())
+    bytes = m_req->get_U32();
+  if(!m_req->eop())
+    ms = m_req->get_U32();
+
   if(m_Streamer != NULL)
-    m_Streamer->RequestPacket();
+    m_Streamer->RequestPacket(bytes, ms);
 
   // no response needed for the request
   return false;
@@ -904,17 +1024,93 @@ bool cXVDRClient::processChannelStream_Signal() /* OPCODE 24 */
   return false;
 }
 
+bool cXVDRClient::processChannelStream_Select() /* OPCODE 25 */
+{
+  cMutexLock lock(&m_streamerLock);
+
+  if(m_Streamer == NULL) {
+    m_resp->put_U32(XVDR_RET_ERROR);
+    return true;
+  }
+
+  std::set<int> pids;
+  std::set<int> types;
+
+  // list of PIDs
+  uint32_t count = m_req->get_U32();
+  for(uint32_t i = 0; i < count && !m_req->eop(); i++) {
+    pids.insert(m_req->get_U32());
+  }
+
+  // list of stream types (as sent with XVDR_STREAM_CHANGE)
+  if(!m_req->eop()) {
+    count = m_req->get_U32();
+    for(uint32_t i = 0; i < count && !m_req->eop(); i++) {
+      const char* name = m_req->get_String();
+      for(int t = cStreamInfo::stMPEG2AUDIO; t <= cStreamInfo::stTELETEXT; t++) {
+        if(strcasecmp(name, cStreamInfo::TypeName((cStreamInfo::Type)t)) == 0) {
+          types.insert(t);
+        }
+      }
+    }
+  }
+
+  m_Streamer->Select(pids, types);
+  m_resp->put_U32(XVDR_RET_OK);
+
+  return true;
+}
+
+bool cXVDRClient::processChannelStream_Seek() /* OPCODE 26 */
+{
+  cMutexLock lock(&m_streamerLock);
+
+  // seek mode (0 = absolute timestamp, 1 = relative offset in milliseconds)
+  bool relative = (m_req->get_U32() == 1);
+  int64_t value = m_req->get_S64();
+
+  if(m_Streamer == NULL || !m_Streamer->TimeShiftMode()) {
+    m_resp->put_U32(XVDR_RET_DATAINVALID);
+    return true;
+  }
+
+  // an empty seek (relative 0) just reports the buffer range
+  bool seek = (!relative || value != 0);
+
+  if(seek && !m_Streamer->Seek(value, relative)) {
+    m_resp->put_U32(XVDR_RET_DATAUNKNOWN);
+    return true;
+  }
+
+  int64_t position = DVD_NOPTS_VALUE;
+  int64_t start = DVD_NOPTS_VALUE;
+  int64_t end = DVD_NOPTS_VALUE;
+
+  uint32_t staged = 0;
+  uint32_t stalls = 0;
+
+  m_Streamer->GetTimeShiftRange(position, start, end);
+  m_Streamer->GetTimeShiftStats(staged, stalls);
+
+  // current position (I-frame), start and end of the timeshift buffer
+  m_resp->put_U32(XVDR_RET_OK);
+  m_resp->put_S64(position);
+  m_resp->put_S64(start);
+  m_resp->put_S64(end);
+
+  // storage statistics (bytes waiting to be written, dropped packets)
+  m_resp->put_U32(staged);
+  m_resp->put_U32(stalls);
+
+  return true;
+}
+
 /** OPCODE 40 - 59: XVDR network functions for recording streaming */
 
 bool cXVDRClient::processRecStream_Open() /* OPCODE 40 */
 {
   cRecording *recording = NULL;
 
-  // only root may change the priority
-  if(geteuid() == 0) {
-    SetPriority(-15);
-  }
-
   const char* recid = m_req->get_String();
   unsigned int uid = recid2uid(recid);
   DEBUGLOG("lookup recid: %s (uid: %u)", recid, uid);
@@ -979,6 +1175,10 @@ bool cXVDRClient::processRecStream_GetBlock() /* OPCODE 42 */
   uint64_t position  = m_req->get_U64();
   uint32_t amount    = m_req->get_U32();
 
+  // don't block live streaming with large blocks. the response may be
+  // shorter than requested, clients continue at position + received bytes
+  amount = std::min(amount, (uint32_t)cXVDRWriter::MaxBulkSize);
+
   uint8_t* p = m_resp->reserve(amount);
   uint32_t amountReceived = m_RecPlayer->getBlock(p, position, amount);
 
@@ -1047,7 +1247,7 @@ bool cXVDRClient::processCHANNELS_GetChannels() /* OPCODE 63 */
 
   XVDRChannels.Unlock();
 
-  m_resp->compress(m_compressionLevel);
+  Compress(m_resp);
 
   return true;
 }
@@ -1455,9 +1655,9 @@ bool cXVDRClient::processRECORDINGS_GetCount() /* OPCODE 101 */
   return true;
 }
 
-bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
+bool cXVDRClient::processRECORDINGS_GetList(MsgPacket* req, MsgPacket* resp) /* OPCODE 102 */
 {
-  cMutexLock lock(&m_timerLock);
+  cCharSetConv toUTF8;
   cRecordingsCache& reccache = cRecordingsCache::GetInstance();
 
   for (cRecording *recording = Recordings.First(); recording; recording = Recordings.Next(recording))
@@ -1477,6 +1677,8 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     }
     else
     {
+      // only the timer of a running recording needs the lock
+      cMutexLock lock(&m_timerLock);
       cRecordControl *rc = cRecordControls::GetRecordControl(recording->FileName());
       if (rc)
       {
@@ -1495,13 +1697,13 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     DEBUGLOG("GRI: RC: recordingStart=%lu recordingDuration=%i", recordingStart, recordingDuration);
 
     // recording_time
-    m_resp->put_U32(recordingStart);
+    resp->put_U32(recordingStart);
 
     // duration
-    m_resp->put_U32(recordingDuration);
+    resp->put_U32(recordingDuration);
 
     // priority
-    m_resp->put_U32(
+    resp->put_U32(
 #if APIVERSNUM >= 10727
     recording->Priority()
 #else
@@ -1510,7 +1712,7 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     );
 
     // lifetime
-    m_resp->put_U32(
+    resp->put_U32(
 #if APIVERSNUM >= 10727
     recording->Lifetime()
 #else
@@ -1519,7 +1721,7 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     );
 
     // channel_name
-    m_resp->put_String(recording->Info()->ChannelName() ? m_toUTF8.Convert(recording->Info()->ChannelName()) : "");
+    resp->put_String(recording->Info()->ChannelName() ? toUTF8.Convert(recording->Info()->ChannelName()) : "");
 
     char* fullname = strdup(recording->Name());
     char* recname = strrchr(fullname, FOLDERDELIMCHAR);
@@ -1535,19 +1737,19 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
     }
 
     // title
-    m_resp->put_String(m_toUTF8.Convert(recname));
+    resp->put_String(toUTF8.Convert(recname));
 
     // subtitle
     if (!isempty(recording->Info()->ShortText()))
-      m_resp->put_String(m_toUTF8.Convert(recording->Info()->ShortText()));
+      resp->put_String(toUTF8.Convert(recording->Info()->ShortText()));
     else
-      m_resp->put_String("");
+      resp->put_String("");
 
     // description
     if (!isempty(recording->Info()->Description()))
-      m_resp->put_String(m_toUTF8.Convert(recording->Info()->Description()));
+      resp->put_String(toUTF8.Convert(recording->Info()->Description()));
     else
-      m_resp->put_String("");
+      resp->put_String("");
 
     // directory
     if(directory != NULL) {
@@ -1560,33 +1762,33 @@ bool cXVDRClient::processRECORDINGS_GetList() /* OPCODE 102 */
       while(*directory == '/') directory++;
     }
 
-    m_resp->put_String((isempty(directory)) ? "" : m_toUTF8.Convert(directory));
+    resp->put_String((isempty(directory)) ? "" : toUTF8.Convert(directory));
 
     // filename / uid of recording
     uint32_t uid = cRecordingsCache::GetInstance().Register(recording);
     char recid[9];
     snprintf(recid, sizeof(recid), "%08x", uid);
-    m_resp->put_String(recid);
+    resp->put_String(recid);
 
     // playcount
-    m_resp->put_U32(reccache.GetPlayCount(uid));
+    resp->put_U32(reccache.GetPlayCount(uid));
 
     // content
     if(event != NULL)
-      m_resp->put_U32(event->Contents());
+      resp->put_U32(event->Contents());
     else
-      m_resp->put_U32(0);
+      resp->put_U32(0);
 
     // thumbnail url - for future use
-    m_resp->put_String("");
+    resp->put_String("");
 
     // icon url - for future use
-    m_resp->put_String("");
+    resp->put_String("");
 
     free(fullname);
   }
 
-  m_resp->compress(m_compressionLevel);
+  Compress(resp);
 
   return true;
 }
@@ -1755,11 +1957,12 @@ bool cXVDRClient::processRECORDINGS_GetMarks() {
 
 /** OPCODE 120 - 139: XVDR network functions for epg access and manipulating */
 
-bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
+bool cXVDRClient::processEPG_GetForChannel(MsgPacket* req, MsgPacket* resp) /* OPCODE 120 */
 {
-  uint32_t channelUID = m_req->get_U32();
-  uint32_t startTime  = m_req->get_U32();
-  uint32_t duration   = m_req->get_U32();
+  cCharSetConv toUTF8;
+  uint32_t channelUID = req->get_U32();
+  uint32_t startTime  = req->get_U32();
+  uint32_t duration   = req->get_U32();
 
   XVDRChannels.Lock(false);
 
@@ -1772,7 +1975,7 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
 
   if (!channel)
   {
-    m_resp->put_U32(0);
+    resp->put_U32(0);
     XVDRChannels.Unlock();
 
     ERRORLOG("written 0 because channel = NULL");
@@ -1783,7 +1986,7 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
   const cSchedules *Schedules = cSchedules::Schedules(MutexLock);
   if (!Schedules)
   {
-    m_resp->put_U32(0);
+    resp->put_U32(0);
     XVDRChannels.Unlock();
 
     DEBUGLOG("written 0 because Schedule!s! = NULL");
@@ -1793,7 +1996,7 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
   const cSchedule *Schedule = Schedules->GetSchedule(channel->GetChannelID());
   if (!Schedule)
   {
-    m_resp->put_U32(0);
+    resp->put_U32(0);
     XVDRChannels.Unlock();
 
     DEBUGLOG("written 0 because Schedule = NULL");
@@ -1843,15 +2046,15 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
     if (!thisEventSubTitle)     thisEventSubTitle     = "";
     if (!thisEventDescription)  thisEventDescription  = "";
 
-    m_resp->put_U32(thisEventID);
-    m_resp->put_U32(thisEventTime);
-    m_resp->put_U32(thisEventDuration);
-    m_resp->put_U32(thisEventContent);
-    m_resp->put_U32(thisEventRating);
+    resp->put_U32(thisEventID);
+    resp->put_U32(thisEventTime);
+    resp->put_U32(thisEventDuration);
+    resp->put_U32(thisEventContent);
+    resp->put_U32(thisEventRating);
 
-    m_resp->put_String(m_toUTF8.Convert(thisEventTitle));
-    m_resp->put_String(m_toUTF8.Convert(thisEventSubTitle));
-    m_resp->put_String(m_toUTF8.Convert(thisEventDescription));
+    resp->put_String(toUTF8.Convert(thisEventTitle));
+    resp->put_String(toUTF8.Convert(thisEventSubTitle));
+    resp->put_String(toUTF8.Convert(thisEventDescription));
 
     atLeastOneEvent = true;
   }
@@ -1861,11 +2064,11 @@ bool cXVDRClient::processEPG_GetForChannel() /* OPCODE 120 */
 
   if (!atLeastOneEvent)
   {
-    m_resp->put_U32(0);
+    resp->put_U32(0);
     DEBUGLOG("Written 0 because no data");
   }
 
-  m_resp->compress(m_compressionLevel);
+  Compress(resp);
 
   return true;
 }
@@ -1945,7 +2148,7 @@ bool cXVDRClient::processSCAN_GetSetup() /* OPCODE 141 */
     m_resp->put_String(toUTF8.Convert(i->full_name));
   }
 
-  m_resp->compress(m_compressionLevel);
+  Compress(m_resp);
   return true;
 }
 
@@ -2040,7 +2243,7 @@ bool cXVDRClient::processSCAN_GetStatus() {
   m_resp->put_String(status.curr_device);
   m_resp->put_String(status.transponder);
 
-  m_resp->compress(m_compressionLevel);
+  Compress(m_resp);
   return true;
 }
 
@@ -2061,12 +2264,45 @@ void cXVDRClient::SendScannerStatus() {
   resp->put_String(status.curr_device);
   resp->put_String(status.transponder);
 
-  resp->compress(m_compressionLevel);
+  Compress(resp);
 
   QueueMessage(resp);
 }
 
+void cXVDRClient::Compress(MsgPacket* p) {
+  // small payloads aren't worth the cpu time
+  if(m_compressionLevel <= 0 || p->getPayloadLength() < XVDRServerConfig.CompressionThreshold)
+    return;
+
+  // compress() freezes the packet (the payload checksum is computed there)
+  if(!m_payloadCheckSum)
+    p->disablePayloadCheckSum();
+
+  p->compress(m_compressionLevel, m_compressionCodec);
+}
+
 void cXVDRClient::QueueMessage(MsgPacket* p) {
-  cMutexLock lock(&m_queueLock);
-  m_queue.push(p);
+  // header checksums are always sent
+  if(!m_payloadCheckSum)
+    p->disablePayloadCheckSum();
+
+  m_writer->Queue(p);
+}
+
+void cXVDRClient::Notify(MsgPacket* p) {
+  // called from VDR's threads, must not wait for request processing
+  m_notifications.Push(p);
+  Wakeup();
+}
+
+void cXVDRClient::Wakeup() {
+  cMutexLock lock(&m_poolLock);
+
+  if(m_workerPool != NULL)
+    m_workerPool->Schedule(this);
+}
+
+void cXVDRClient::SetWorkerPool(cXVDRWorkerPool* pool) {
+  cMutexLock lock(&m_poolLock);
+  m_workerPool = pool;
 }
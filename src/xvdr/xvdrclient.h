@@ -29,7 +29,6 @@
 #include <map>
 #include <list>
 #include <string>
-#include <queue>
 #include <set>
 
 #include <vdr/thread.h>
@@ -39,16 +38,19 @@
 
 #include "demuxer/streaminfo.h"
 #include "scanner/wirbelscan.h"
+#include "tools/mpscqueue.h"
 
 class cChannel;
 class cDevice;
 class cLiveStreamer;
 class MsgPacket;
+class MsgReader;
 class cRecPlayer;
 class cCmdControl;
+class cXVDRWorkerPool;
+class cXVDRWriter;
 
-class cXVDRClient : public cThread
-                  , public cStatus
+class cXVDRClient : public cStatus
 {
 private:
 
@@ -58,6 +60,7 @@ private:
   bool              m_StatusInterfaceEnabled;
   cLiveStreamer    *m_Streamer;
   cRecPlayer       *m_RecPlayer;
+  MsgReader        *m_reader;
   MsgPacket        *m_req;
   MsgPacket        *m_resp;
   cCharSetConv      m_toUTF8;
@@ -66,6 +69,8 @@ private:
   cMutex            m_streamerLock;
   static cMutex     m_timerLock;
   int               m_compressionLevel;
+  int               m_compressionCodec;
+  bool              m_payloadCheckSum;
   int               m_LanguageIndex;
   cStreamInfo::Type m_LangStreamType;
   std::list<int>    m_caids;
@@ -75,19 +80,25 @@ private:
   int               m_timeout;
   cWirbelScan       m_scanner;
   bool              m_scanSupported;
+  cTimeMs           m_scanTimer;
+  bool              m_closed;
   std::string       m_clientName;
 
-  std::queue<MsgPacket*> m_queue;
-  cMutex                 m_queueLock;
+  cXVDRWriter           *m_writer;
+  cXVDRWorkerPool       *m_workerPool;
+  cMutex                 m_poolLock;
+
+  // status notifications raised by VDR
+  cMPSCQueue<MsgPacket*> m_notifications;
+  volatile int           m_channelsChanged;
 
 protected:
 
   bool processRequest();
 
-  virtual void Action(void);
+  static bool IsAsyncRequest(uint16_t msgid);
 
   virtual void TimerChange(const cTimer *Timer, eTimerChange Change);
-  virtual void ChannelChange(const cChannel *Channel);
   virtual void Recording(const cDevice *Device, const char *Name, const char *FileName, bool On);
   virtual void OsdStatusMessage(const char *Message);
 
@@ -100,18 +111,26 @@ public:
   void RecordingsChange();
   void TimerChange();
 
+  bool Process();
+  bool processRequestAsync(MsgPacket* req);
+  bool HasPendingWork();
+  bool IsClosed() { return m_closed; }
+  void SetWorkerPool(cXVDRWorkerPool* pool);
+
   void QueueMessage(MsgPacket* p);
   void StatusMessage(const char *Message);
+  void Notify(MsgPacket* p);
 
   unsigned int GetID() { return m_Id; }
   const std::string& GetClientName() { return m_clientName; }
   int GetSocket() { return m_socket; }
+  cXVDRWriter* GetWriter() { return m_writer; }
 
 protected:
 
   void SetLoggedIn(bool yesNo) { m_loggedIn = yesNo; }
   void SetStatusInterface(bool yesNo) { m_StatusInterfaceEnabled = yesNo; }
-  int StartChannelStreaming(const cChannel *channel, uint32_t timeout, int32_t priority, bool waitforiframe = false);
+  int StartChannelStreaming(const cChannel *channel, uint32_t timeout, int32_t priority, bool waitforiframe = false, bool rawts = false);
   void StopChannelStreaming();
 
 private:
@@ -124,6 +143,9 @@ private:
 
   std::map<std::string, ChannelGroup> m_channelgroups[2];
 
+  void Wakeup();
+  void SendChannelsChanged();
+  void Compress(MsgPacket* p);
   void PutTimer(cTimer* timer, MsgPacket* p);
   bool IsChannelWanted(cChannel* channel, int type = 0);
   int  ChannelsCount();
@@ -141,6 +163,8 @@ private:
   bool processChannelStream_Pause();
   bool processChannelStream_Request();
   bool processChannelStream_Signal();
+  bool processChannelStream_Select();
+  bool processChannelStream_Seek();
 
   bool processRecStream_Open();
   bool processRecStream_Close();
@@ -164,7 +188,7 @@ private:
 
   bool processRECORDINGS_GetDiskSpace();
   bool processRECORDINGS_GetCount();
-  bool processRECORDINGS_GetList();
+  bool processRECORDINGS_GetList(MsgPacket* req, MsgPacket* resp);
   bool processRECORDINGS_GetInfo();
   bool processRECORDINGS_Rename();
   bool processRECORDINGS_Delete();
@@ -174,7 +198,7 @@ private:
   bool processRECORDINGS_GetPosition();
   bool processRECORDINGS_GetMarks();
 
-  bool processEPG_GetForChannel();
+  bool processEPG_GetForChannel(MsgPacket* req, MsgPacket* resp);
 
   bool processSCAN_ScanSupported();
   bool processSCAN_GetSetup();
@@ -53,11 +53,13 @@
 #define XVDR_CHANNELSTREAM_REQUEST 22
 #define XVDR_CHANNELSTREAM_PAUSE   23
 #define XVDR_CHANNELSTREAM_SIGNAL  24
+#define XVDR_CHANNELSTREAM_SELECT  25
+#define XVDR_CHANNELSTREAM_SEEK    26
 
 /* OPCODE 40 - 59: XVDR network functions for recording streaming */
 #define XVDR_RECSTREAM_OPEN        40
 #define XVDR_RECSTREAM_CLOSE       41
-#define XVDR_RECSTREAM_GETBLOCK    42
+#define XVDR_RECSTREAM_GETBLOCK    42 /* may return fewer bytes than requested (at most 64 KB) */
 #define XVDR_RECSTREAM_UPDATE      46
 
 /* OPCODE 60 - 79: XVDR network functions for channel access */
@@ -104,6 +106,7 @@
 #define XVDR_STREAM_MUXPKT       4
 #define XVDR_STREAM_SIGNALINFO   5
 #define XVDR_STREAM_DETACH       7
+#define XVDR_STREAM_TSPACKETS    8
 
 /** Stream status codes */
 #define XVDR_STREAM_STATUS_SIGNALLOST     111
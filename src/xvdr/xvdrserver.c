@@ -25,6 +25,7 @@
 
 #include <netdb.h>
 #include <poll.h>
+#include <sys/epoll.h>
 #include <assert.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -42,6 +43,7 @@
 
 #include "xvdrserver.h"
 #include "xvdrclient.h"
+#include "xvdrworker.h"
 #include "xvdrchannels.h"
 #include "live/channelcache.h"
 #include "recordings/recordingscache.h"
@@ -75,6 +77,8 @@ public:
 
 cXVDRServer::cXVDRServer(int listenPort) : cThread("VDR XVDR Server")
 {
+  m_epollFD      = -1;
+  m_workers      = NULL;
   m_IPv4Fallback = false;
   m_ServerPort  = listenPort;
 
@@ -133,6 +137,26 @@ cXVDRServer::cXVDRServer(int listenPort) : cThread("VDR XVDR Server")
 
   listen(m_ServerFD, 10);
 
+  m_epollFD = epoll_create(MaxEvents);
+  if (m_epollFD == -1)
+  {
+    ERRORLOG("cXVDRServer: epoll_create failed (errno=%d: %s)", errno, strerror(errno));
+    close(m_ServerFD);
+    m_ServerFD = -1;
+    return;
+  }
+
+  fcntl(m_epollFD, F_SETFD, fcntl(m_epollFD, F_GETFD) | FD_CLOEXEC);
+
+  // the listening socket is registered without a client
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = EPOLLIN;
+  ev.data.ptr = NULL;
+  epoll_ctl(m_epollFD, EPOLL_CTL_ADD, m_ServerFD, &ev);
+
+  m_workers = new cXVDRWorkerPool(m_epollFD, cXVDRWorkerPool::GetThreadCount());
+
   Start();
 
   INFOLOG("XVDR Server started");
@@ -143,11 +167,18 @@ cXVDRServer::cXVDRServer(int listenPort) : cThread("VDR XVDR Server")
 cXVDRServer::~cXVDRServer()
 {
   Cancel(5);
+
+  // stop request processing before the clients go away
+  delete m_workers;
+
   for (ClientList::iterator i = m_clients.begin(); i != m_clients.end(); i++)
   {
     delete (*i);
   }
 
+  if (m_epollFD != -1)
+    close(m_epollFD);
+
   INFOLOG("XVDR Server stopped");
 }
 
@@ -214,14 +245,22 @@ void cXVDRServer::NewClientConnected(int fd)
   else
     INFOLOG("Client %s:%i with ID %d connected.", inet_ntoa(((struct sockaddr_in *)&sin)->sin_addr), ((struct sockaddr_in *)&sin)->sin_port, m_IdCnt);
   cXVDRClient *connection = new cXVDRClient(fd, m_IdCnt);
+
+  if (!cXVDRWorkerPool::Arm(m_epollFD, EPOLL_CTL_ADD, connection))
+  {
+    delete connection;
+    return;
+  }
+
+  connection->SetWorkerPool(m_workers);
   m_clients.push_back(connection);
   m_IdCnt++;
 }
 
 void cXVDRServer::Action(void)
 {
-  fd_set fds;
-  struct timeval tv;
+  struct epoll_event events[MaxEvents];
+  cTimeMs houseKeepingTimer;
   cTimeMs channelReloadTimer;
   cTimeMs channelCacheTimer;
   cTimeMs recordingReloadTimer;
@@ -241,33 +280,56 @@ void cXVDRServer::Action(void)
 
   while (Running())
   {
-    FD_ZERO(&fds);
-    FD_SET(m_ServerFD, &fds);
-
-    tv.tv_sec = 0;
-    tv.tv_usec = 250*1000;
-
-    int r = select(m_ServerFD + 1, &fds, NULL, NULL, &tv);
+    int r = epoll_wait(m_epollFD, events, MaxEvents, 250);
     if (r == -1)
     {
-      ERRORLOG("failed during select");
+      if (errno != EINTR)
+        ERRORLOG("failed during epoll_wait");
       continue;
     }
-    if (r == 0)
+
+    for (int n = 0; n < r; n++)
+    {
+      // connect request
+      if (events[n].data.ptr == NULL)
+      {
+        int fd = accept(m_ServerFD, 0, 0);
+        if (fd >= 0)
+          NewClientConnected(fd);
+        else
+          ERRORLOG("accept failed");
+
+        continue;
+      }
+
+      // incoming request (or disconnect)
+      m_workers->Schedule((cXVDRClient*)events[n].data.ptr);
+    }
+
+    if (houseKeepingTimer.Elapsed() >= 250)
     {
+      houseKeepingTimer.Set(0);
+
       // remove disconnected clients
       bool bChanged = false;
       for (ClientList::iterator i = m_clients.begin(); i != m_clients.end();)
       {
+        cXVDRClient* client = *i;
 
-        if (!(*i)->Active())
+        if (client->IsClosed())
         {
-          INFOLOG("Client with ID %u seems to be disconnected, removing from client list", (*i)->GetID());
-          delete (*i);
+          INFOLOG("Client with ID %u seems to be disconnected, removing from client list", client->GetID());
+          epoll_ctl(m_epollFD, EPOLL_CTL_DEL, client->GetSocket(), NULL);
+          client->SetWorkerPool(NULL);
+          m_workers->Remove(client);
+          delete client;
           i = m_clients.erase(i);
           bChanged = true;
         }
         else {
+          // retry pending messages, scanner status, ...
+          if (client->HasPendingWork())
+            m_workers->Schedule(client);
           i++;
         }
       }
@@ -343,19 +405,6 @@ void cXVDRServer::Action(void)
 
         recordingReloadTrigger = false;
       }
-
-      // no connect request -> continue waiting
-      continue;
-    }
-
-    int fd = accept(m_ServerFD, 0, 0);
-    if (fd >= 0)
-    {
-      NewClientConnected(fd);
-    }
-    else
-    {
-      ERRORLOG("accept failed");
     }
   }
   return;
@@ -32,6 +32,7 @@
 #include "config/config.h"
 
 class cXVDRClient;
+class cXVDRWorkerPool;
 
 class cXVDRServer : public cThread
 {
@@ -44,9 +45,13 @@ protected:
 
   int           m_ServerPort;
   int           m_ServerFD;
+  int           m_epollFD;
   bool          m_IPv4Fallback;
   cString       m_AllowedHostsFile;
   ClientList    m_clients;
+  cXVDRWorkerPool *m_workers;
+
+  enum { MaxEvents = 64 };
 
   static unsigned int m_IdCnt;
 
@@ -0,0 +1,257 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <sys/epoll.h>
+#include <errno.h>
+#include <string.h>
+
+#include "config/config.h"
+#include "net/msgpacket.h"
+#include "xvdrworker.h"
+#include "xvdrclient.h"
+
+int cXVDRWorkerPool::m_threadCount = 4;
+
+cXVDRWorkerPool::cWorker::cWorker(cXVDRWorkerPool* pool, int index) : cThread(cString::sprintf("XVDR Worker %i", index)), m_pool(pool)
+{
+  Start();
+}
+
+void cXVDRWorkerPool::cWorker::Stop(int WaitSeconds)
+{
+  Cancel(WaitSeconds);
+}
+
+void cXVDRWorkerPool::cWorker::Action()
+{
+  Job job;
+
+  while(Running())
+  {
+    if(!m_pool->Get(job))
+      continue;
+
+    if(job.request != NULL)
+    {
+      job.client->processRequestAsync(job.request);
+      delete job.request;
+    }
+    else
+      job.client->Process();
+
+    m_pool->Done(job);
+  }
+}
+
+cXVDRWorkerPool::cXVDRWorkerPool(int epollfd, int threads) : m_epollfd(epollfd), m_stop(false)
+{
+  if(threads < 1)
+    threads = 1;
+
+  for(int i = 0; i < threads; i++)
+    m_workers.push_back(new cWorker(this, i));
+
+  INFOLOG("Started %i worker threads", threads);
+}
+
+cXVDRWorkerPool::~cXVDRWorkerPool()
+{
+  {
+    cMutexLock lock(&m_lock);
+    m_stop = true;
+
+    for(std::deque<Job>::iterator i = m_jobs.begin(); i != m_jobs.end(); i++)
+      delete i->request;
+
+    m_jobs.clear();
+    m_cond.Broadcast();
+  }
+
+  for(std::vector<cWorker*>::iterator i = m_workers.begin(); i != m_workers.end(); i++)
+    (*i)->Stop(-1);
+
+  {
+    cMutexLock lock(&m_lock);
+    m_cond.Broadcast();
+  }
+
+  for(std::vector<cWorker*>::iterator i = m_workers.begin(); i != m_workers.end(); i++)
+  {
+    (*i)->Stop(5);
+    delete *i;
+  }
+}
+
+void cXVDRWorkerPool::Schedule(cXVDRClient* client)
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_stop)
+    return;
+
+  // already waiting or in progress, run again when done
+  if(!m_busy.insert(client).second)
+  {
+    m_again.insert(client);
+    return;
+  }
+
+  Job job = { client, NULL };
+  m_jobs.push_back(job);
+  m_cond.Broadcast();
+}
+
+bool cXVDRWorkerPool::Execute(cXVDRClient* client, MsgPacket* request)
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_stop)
+    return false;
+
+  m_requests[client]++;
+
+  Job job = { client, request };
+  m_jobs.push_back(job);
+  m_cond.Broadcast();
+
+  return true;
+}
+
+void cXVDRWorkerPool::Remove(cXVDRClient* client)
+{
+  cMutexLock lock(&m_lock);
+
+  m_again.erase(client);
+
+  // drop waiting jobs
+  for(std::deque<Job>::iterator i = m_jobs.begin(); i != m_jobs.end();)
+  {
+    if(i->client != client)
+    {
+      i++;
+      continue;
+    }
+
+    if(i->request != NULL)
+    {
+      delete i->request;
+      m_requests[client]--;
+    }
+    else
+      m_busy.erase(client);
+
+    i = m_jobs.erase(i);
+  }
+
+  // wait until the workers have finished processing
+  while(IsBusy(client))
+    m_idle.Wait(m_lock);
+
+  m_requests.erase(client);
+}
+
+bool cXVDRWorkerPool::IsBusy(cXVDRClient* client)
+{
+  if(m_busy.find(client) != m_busy.end())
+    return true;
+
+  std::map<cXVDRClient*, int>::iterator i = m_requests.find(client);
+  return (i != m_requests.end() && i->second > 0);
+}
+
+bool cXVDRWorkerPool::Get(Job& job)
+{
+  cMutexLock lock(&m_lock);
+
+  if(m_jobs.empty() && !m_stop)
+    m_cond.TimedWait(m_lock, 1000);
+
+  if(m_jobs.empty() || m_stop)
+    return false;
+
+  job = m_jobs.front();
+  m_jobs.pop_front();
+
+  return true;
+}
+
+void cXVDRWorkerPool::Done(const Job& job)
+{
+  cXVDRClient* client = job.client;
+
+  if(job.request != NULL)
+  {
+    cMutexLock lock(&m_lock);
+    m_requests[client]--;
+    m_idle.Broadcast();
+    return;
+  }
+
+  // wait for further requests
+  if(!client->IsClosed())
+    Arm(m_epollfd, EPOLL_CTL_MOD, client);
+
+  cMutexLock lock(&m_lock);
+
+  // client has been scheduled while in progress
+  if(m_again.erase(client) > 0 && !m_stop && !client->IsClosed())
+  {
+    m_jobs.push_back(job);
+    m_cond.Broadcast();
+    return;
+  }
+
+  m_busy.erase(client);
+  m_idle.Broadcast();
+}
+
+bool cXVDRWorkerPool::Arm(int epollfd, int op, cXVDRClient* client)
+{
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+
+  ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+  ev.data.ptr = client;
+
+  if(epoll_ctl(epollfd, op, client->GetSocket(), &ev) == -1)
+  {
+    // socket may have been removed in the meantime
+    if(errno != ENOENT)
+      ERRORLOG("epoll_ctl failed for client %u (errno=%d: %s)", client->GetID(), errno, strerror(errno));
+
+    return false;
+  }
+
+  return true;
+}
+
+void cXVDRWorkerPool::SetThreadCount(int count)
+{
+  m_threadCount = count;
+}
+
+int cXVDRWorkerPool::GetThreadCount()
+{
+  return m_threadCount;
+}
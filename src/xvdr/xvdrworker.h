@@ -0,0 +1,119 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_WORKER_H
+#define XVDR_WORKER_H
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+#include <vdr/thread.h>
+
+class cXVDRClient;
+class MsgPacket;
+
+// Worker threads processing client requests.
+// The server thread waits for socket events of all clients and schedules
+// clients with pending input (or output) here. Sockets are registered with
+// EPOLLONESHOT and re-armed after the client has been processed, so a
+// client is never handled by more than one worker at a time.
+// Bulk requests may be executed separately (concurrently to the client's
+// other requests).
+
+class cXVDRWorkerPool
+{
+public:
+
+  cXVDRWorkerPool(int epollfd, int threads);
+
+  virtual ~cXVDRWorkerPool();
+
+  void Schedule(cXVDRClient* client);
+
+  bool Execute(cXVDRClient* client, MsgPacket* request);
+
+  void Remove(cXVDRClient* client);
+
+  static bool Arm(int epollfd, int op, cXVDRClient* client);
+
+  static void SetThreadCount(int count);
+
+  static int GetThreadCount();
+
+private:
+
+  class cWorker : public cThread
+  {
+  public:
+
+    cWorker(cXVDRWorkerPool* pool, int index);
+
+    void Stop(int WaitSeconds);
+
+  protected:
+
+    void Action();
+
+  private:
+
+    cXVDRWorkerPool* m_pool;
+  };
+
+  struct Job
+  {
+    cXVDRClient* client;
+    MsgPacket* request;
+  };
+
+  bool Get(Job& job);
+
+  void Done(const Job& job);
+
+  bool IsBusy(cXVDRClient* client);
+
+  int m_epollfd;
+
+  std::vector<cWorker*> m_workers;
+
+  std::deque<Job> m_jobs;
+
+  std::set<cXVDRClient*> m_busy;
+
+  std::set<cXVDRClient*> m_again;
+
+  std::map<cXVDRClient*, int> m_requests;
+
+  cMutex m_lock;
+
+  cCondVar m_cond;
+
+  cCondVar m_idle;
+
+  bool m_stop;
+
+  static int m_threadCount;
+};
+
+#endif // XVDR_WORKER_H
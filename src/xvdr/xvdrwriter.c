@@ -0,0 +1,236 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <time.h>
+#include <sys/socket.h>
+#include <algorithm>
+
+#include "config/config.h"
+#include "net/msgpacket.h"
+#include "live/livequeue.h"
+#include "xvdrwriter.h"
+
+int cXVDRWriter::MaxBatchPackets = 64;
+int cXVDRWriter::BatchLatency = 0;
+
+static uint64_t TimeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+cXVDRWriter::cXVDRWriter(int sock, unsigned int id) : cThread(cString::sprintf("XVDR Writer %u", id)), m_socket(sock), m_id(id), m_stream(NULL), m_active(false)
+{
+  m_sentCount = 0;
+  m_sentLatency = 0;
+  m_sentLatencyMax = 0;
+}
+
+cXVDRWriter::~cXVDRWriter()
+{
+  Cancel(-1);
+  Wakeup();
+  Cancel(3);
+
+  cMutexLock lock(&m_lock);
+
+  while(!m_control.empty()) {
+    delete m_control.front().packet;
+    m_control.pop_front();
+  }
+
+  while(!m_bulk.empty()) {
+    delete m_bulk.front().packet;
+    m_bulk.pop_front();
+  }
+
+  if(m_sentCount > 0) {
+    INFOLOG("Client %u: %u messages sent, latency avg %.2f ms, max %.2f ms", m_id, m_sentCount, (double)m_sentLatency / m_sentCount / 1000.0, (double)m_sentLatencyMax / 1000.0);
+  }
+}
+
+void cXVDRWriter::StartWriter()
+{
+  // called with m_lock held
+  if(m_active) {
+    return;
+  }
+
+  // the previous (idle) writer thread may still be finishing
+  while(Active()) {
+    cCondWait::SleepMs(1);
+  }
+
+  m_active = true;
+  Start();
+}
+
+void cXVDRWriter::Queue(MsgPacket* p)
+{
+  sItem item;
+  item.packet = p;
+  item.time = TimeUs();
+
+  cMutexLock lock(&m_lock);
+
+  if(p->getPacketLength() > BulkThreshold) {
+    m_bulk.push_back(item);
+  }
+  else {
+    m_control.push_back(item);
+  }
+
+  StartWriter();
+  m_cond.Broadcast();
+}
+
+void cXVDRWriter::SetStreamQueue(cLiveQueue* queue)
+{
+  // the writer never holds the lock while sending, so the queue
+  // isn't referenced anymore after this call
+  cMutexLock lock(&m_lock);
+  m_stream = queue;
+
+  if(m_stream != NULL) {
+    StartWriter();
+  }
+
+  m_cond.Broadcast();
+}
+
+void cXVDRWriter::Wakeup()
+{
+  cMutexLock lock(&m_lock);
+  m_cond.Broadcast();
+}
+
+int cXVDRWriter::Take(std::deque<sItem>& lane, MsgPacket** batch, int max)
+{
+  int count = 0;
+  uint64_t now = TimeUs();
+
+  while(!lane.empty() && count < max) {
+    uint64_t latency = now - lane.front().time;
+    m_sentLatency += latency;
+    m_sentLatencyMax = std::max(m_sentLatencyMax, latency);
+    m_sentCount++;
+
+    batch[count++] = lane.front().packet;
+    lane.pop_front();
+  }
+
+  return count;
+}
+
+void cXVDRWriter::Action()
+{
+  int batchsize = MaxBatchPackets;
+  MsgPacket** batch = new MsgPacket*[batchsize];
+  cTimeMs idle(IdleTimeout);
+
+  while(Running())
+  {
+    int count = 0;
+    int generation = 0;
+    bool stream = false;
+
+    m_lock.Lock();
+
+    // wait for outgoing messages
+    if(m_control.empty() && m_bulk.empty() && (m_stream == NULL || !m_stream->IsReady())) {
+      m_cond.TimedWait(m_lock, 1000);
+    }
+
+    // nothing to send for a while - end the thread (restarted by Queue())
+    if(m_control.empty() && m_bulk.empty() && m_stream == NULL && idle.TimedOut()) {
+      m_active = false;
+      m_lock.Unlock();
+      break;
+    }
+
+    // 1. control / status messages
+    if(!m_control.empty()) {
+      count = Take(m_control, batch, batchsize);
+    }
+    // 2. stream packets
+    else if(m_stream != NULL && m_stream->IsReady()) {
+      // give the queue some time to fill up (bounded latency)
+      if(BatchLatency > 0 && m_stream->Size() < batchsize) {
+        m_cond.TimedWait(m_lock, BatchLatency);
+      }
+
+      // control messages go first
+      if(m_control.empty() && m_stream != NULL) {
+        count = m_stream->Take(batch, batchsize, generation);
+        stream = true;
+      }
+    }
+    // 3. bulk responses (one at a time)
+    else if(!m_bulk.empty()) {
+      count = Take(m_bulk, batch, 1);
+    }
+
+    m_lock.Unlock();
+
+    if(count == 0) {
+      continue;
+    }
+
+    idle.Set(IdleTimeout);
+
+    // stream packets flushed in the meantime are stale
+    bool stale = false;
+
+    if(stream) {
+      cMutexLock lock(&m_lock);
+      stale = (m_stream == NULL || m_stream->IsStale(generation));
+    }
+
+    // failed to send a response - close the connection
+    // (the server notices the hangup and removes the client)
+    if(!stale && !MsgPacket::write(m_socket, batch, count, stream ? 500 : 3000) && !stream) {
+      ERRORLOG("Client %u: failed to send response - closing connection", m_id);
+      shutdown(m_socket, SHUT_RDWR);
+    }
+
+    for(int i = 0; i < count; i++) {
+      delete batch[i];
+    }
+  }
+
+  delete[] batch;
+}
+
+void cXVDRWriter::SetMaxBatchPackets(int count)
+{
+  MaxBatchPackets = (count < 1) ? 1 : count;
+  DEBUGLOG("MAXBATCHPACKETS: %i", MaxBatchPackets);
+}
+
+void cXVDRWriter::SetBatchLatency(int ms)
+{
+  BatchLatency = (ms < 0) ? 0 : ms;
+  DEBUGLOG("BATCHLATENCY: %i ms", BatchLatency);
+}
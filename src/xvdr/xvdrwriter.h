@@ -0,0 +1,119 @@
+/*
+ *      vdr-plugin-xvdr - XVDR server plugin for VDR
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#ifndef XVDR_WRITER_H
+#define XVDR_WRITER_H
+
+#include <stdint.h>
+#include <deque>
+#include <vdr/thread.h>
+
+class MsgPacket;
+class cLiveQueue;
+
+// Single writer of a client connection.
+// The thread is started on demand and ends after some idle time (without a
+// stream attached), so idle connections don't occupy a thread and request
+// processing never waits for a slow client.
+// All outbound messages are sent by this thread with the following priority:
+//
+//   1. control and status messages (small responses)
+//   2. stream packets (taken from the live queue of the client)
+//   3. bulk responses
+//
+// Messages can't be interleaved on the wire, so a bulk response which has
+// been started delays real-time traffic by its whole transfer time. Bulk
+// responses are only started while no stream packets are waiting, and
+// recording blocks are limited to MaxBulkSize. Large EPG or recording
+// lists are still sent as one message (the protocol has no fragmentation).
+
+class cXVDRWriter : public cThread
+{
+public:
+
+  enum {
+    BulkThreshold = 16 * 1024,  // messages larger than this are sent as bulk
+    MaxBulkSize = 64 * 1024,    // preferred maximum size of bulk responses
+    IdleTimeout = 5000          // writer thread ends after this time without messages (ms)
+  };
+
+  cXVDRWriter(int sock, unsigned int id);
+
+  virtual ~cXVDRWriter();
+
+  void Queue(MsgPacket* p);
+
+  void SetStreamQueue(cLiveQueue* queue);
+
+  void Wakeup();
+
+  static void SetMaxBatchPackets(int count);
+
+  static void SetBatchLatency(int ms);
+
+protected:
+
+  void Action();
+
+private:
+
+  struct sItem {
+    MsgPacket* packet;
+    uint64_t   time;
+  };
+
+  int Take(std::deque<sItem>& lane, MsgPacket** batch, int max);
+
+  void StartWriter();
+
+  int m_socket;
+
+  unsigned int m_id;
+
+  std::deque<sItem> m_control;
+
+  std::deque<sItem> m_bulk;
+
+  cLiveQueue* m_stream;
+
+  // writer thread running (or about to be started)
+  bool m_active;
+
+  cMutex m_lock;
+
+  cCondVar m_cond;
+
+  // enqueue-to-send latency of control and bulk messages (microseconds)
+  uint32_t m_sentCount;
+
+  uint64_t m_sentLatency;
+
+  uint64_t m_sentLatencyMax;
+
+  static int MaxBatchPackets;
+
+  static int BatchLatency;
+};
+
+#endif // XVDR_WRITER_H
@@ -0,0 +1,175 @@
+/*
+ *      XVDR cMPSCQueue stress check
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "tools/mpscqueue.h"
+
+// Several producers push while the consumer is stalled (like VDR threads
+// calling cXVDRClient::Notify() while the client is busy), then while the
+// consumer is running. Push() must never wait for the consumer and every
+// producer's items must arrive complete and in order.
+
+struct sItem {
+  int      producer;
+  uint32_t seq;
+};
+
+static const int Producers = 8;
+static const uint32_t Items = 200000;
+
+// a single push must not take longer than this (allocation and scheduling
+// noise only - a blocked push would hang until the consumer runs)
+static const uint64_t MaxPushTimeUs = 1000000;
+
+static cMPSCQueue<sItem> queue;
+static volatile int finished = 0;
+static volatile uint64_t maxPushTime = 0;
+
+static uint64_t TimeUs()
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void* Producer(void* arg)
+{
+  int id = (int)(intptr_t)arg;
+  uint64_t worst = 0;
+
+  for(uint32_t i = 0; i < Items; i++) {
+    sItem item;
+    item.producer = id;
+    item.seq = i;
+
+    uint64_t start = TimeUs();
+    queue.Push(item);
+    uint64_t elapsed = TimeUs() - start;
+
+    if(elapsed > worst)
+      worst = elapsed;
+  }
+
+  uint64_t current;
+  while((current = maxPushTime) < worst && !__sync_bool_compare_and_swap(&maxPushTime, current, worst))
+    ;
+
+  __sync_add_and_fetch(&finished, 1);
+  return NULL;
+}
+
+// pop everything, check completeness and per-producer order
+static bool Drain(uint32_t* next, bool wait)
+{
+  uint64_t total = (uint64_t)Producers * Items;
+  uint64_t received = 0;
+
+  for(int i = 0; i < Producers; i++)
+    received += next[i];
+
+  while(received < total) {
+    sItem item;
+
+    if(!queue.Pop(item)) {
+      if(!wait) {
+        fprintf(stderr, "FAILED: %llu of %llu items received\n", (unsigned long long)received, (unsigned long long)total);
+        return false;
+      }
+      sched_yield();
+      continue;
+    }
+
+    if(item.producer < 0 || item.producer >= Producers || item.seq != next[item.producer]) {
+      fprintf(stderr, "FAILED: producer %i item %u out of order (expected %u)\n", item.producer, item.seq, next[item.producer]);
+      return false;
+    }
+
+    next[item.producer]++;
+    received++;
+  }
+
+  if(!queue.Empty()) {
+    fprintf(stderr, "FAILED: queue not empty after all items were received\n");
+    return false;
+  }
+
+  return true;
+}
+
+static bool Run(bool stalled)
+{
+  pthread_t threads[Producers];
+  uint32_t next[Producers] = { 0 };
+
+  finished = 0;
+  maxPushTime = 0;
+
+  for(int i = 0; i < Producers; i++)
+    pthread_create(&threads[i], NULL, Producer, (void*)(intptr_t)i);
+
+  bool rc = true;
+
+  if(stalled) {
+    // the consumer doesn't pop, all producers have to finish anyway
+    uint64_t timeout = TimeUs() + 30000000;
+
+    while(finished < Producers && TimeUs() < timeout)
+      usleep(1000);
+
+    if(finished < Producers) {
+      fprintf(stderr, "FAILED: producers blocked by the stalled consumer\n");
+      return false;
+    }
+  }
+
+  rc = Drain(next, !stalled);
+
+  for(int i = 0; i < Producers; i++)
+    pthread_join(threads[i], NULL);
+
+  if(rc && maxPushTime > MaxPushTimeUs) {
+    fprintf(stderr, "FAILED: Push() took %llu us\n", (unsigned long long)maxPushTime);
+    rc = false;
+  }
+
+  printf("%s consumer: %i x %u items, max push time %llu us - %s\n", stalled ? "stalled" : "running", Producers, Items, (unsigned long long)maxPushTime, rc ? "OK" : "FAILED");
+  return rc;
+}
+
+int main(int argc, char* argv[])
+{
+  if(!Run(true))
+    return 1;
+
+  if(!Run(false))
+    return 1;
+
+  return 0;
+}
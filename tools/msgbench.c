@@ -0,0 +1,557 @@
+/*
+ *      XVDR MsgPacket / Transport Benchmark
+ *
+ *      Copyright (C) 2012 Alexander Pipelka
+ *
+ *      https://github.com/pipelka/vdr-plugin-xvdr
+ *
+ *  This Program is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2, or (at your option)
+ *  any later version.
+ *
+ *  This Program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  the Free Software Foundation, 675 Mass Ave, Cambridge, MA 02139, USA.
+ *  http://www.gnu.org/copyleft/gpl.html
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+#include "os-config.h"
+#include "msgpacket.h"
+#include "msgreader.h"
+#include "crc32.h"
+
+// output format (one line per benchmark):
+// name,size,iterations,ns_per_op,mb_per_s
+
+static double mintime = 0.2;
+static const char* filter = NULL;
+
+static const uint32_t blobsizes[] = { 188, 1316, 4096, 16384, 65536, 262144, 1048576 };
+static const int blobcount = sizeof(blobsizes) / sizeof(blobsizes[0]);
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static bool enabled(const char* name) {
+	return (filter == NULL || strstr(name, filter) != NULL);
+}
+
+static void report(const char* name, uint32_t size, uint64_t iterations, double elapsed) {
+	double ns = elapsed * 1e9 / iterations;
+	double mbs = (size > 0) ? (size * (double)iterations) / (elapsed * 1024 * 1024) : 0;
+
+	printf("%s,%u,%llu,%.1f,%.1f\n", name, size, (unsigned long long)iterations, ns, mbs);
+	fflush(stdout);
+}
+
+// run a benchmark function with an increasing number of iterations until it
+// takes at least "mintime" seconds
+
+typedef void (*BenchFunc)(uint64_t iterations, uint32_t size, void* arg);
+
+static void run(const char* name, uint32_t size, BenchFunc func, void* arg = NULL) {
+	if(!enabled(name)) {
+		return;
+	}
+
+	uint64_t iterations = 1;
+	double elapsed = 0;
+
+	for(;;) {
+		double start = now();
+		func(iterations, size, arg);
+		elapsed = now() - start;
+
+		if(elapsed >= mintime || iterations >= (1ULL << 40)) {
+			break;
+		}
+
+		// estimate the number of iterations needed
+		uint64_t next = (elapsed > 0) ? (uint64_t)(iterations * mintime * 1.2 / elapsed) : iterations * 100;
+
+		if(next > iterations * 100) {
+			next = iterations * 100;
+		}
+
+		iterations = (next > iterations) ? next : iterations * 2;
+	}
+
+	report(name, size, iterations, elapsed);
+}
+
+static uint8_t* testdata(uint32_t size, bool compressible) {
+	uint8_t* data = (uint8_t*)malloc(size);
+	const char* text = "ORF1 HD;ORF:11302:HC23M5O35P0S1:S19.2E:22000:1920=27:1921=deu@3,1922=mis@3;1925=deu@106:1923:D05,D95,648:4911:1:1007:0\n";
+	uint32_t textlen = strlen(text);
+
+	for(uint32_t i = 0; i < size; i++) {
+		data[i] = compressible ? text[i % textlen] ^ (rand() % 7 == 0 ? 0x20 : 0) : rand();
+	}
+
+	return data;
+}
+
+// put / get benchmarks
+
+#define BENCH_PUT(T, func, value) \
+static void bench_put_##T(uint64_t iterations, uint32_t, void*) { \
+	MsgPacket p; \
+	for(uint64_t i = 0; i < iterations; i++) { \
+		if((i & 1023) == 0) { p.clear(); } \
+		p.func(value); \
+	} \
+}
+
+#define BENCH_GET(T, put, get, value) \
+static void bench_get_##T(uint64_t iterations, uint32_t, void*) { \
+	MsgPacket p; \
+	for(int i = 0; i < 1024; i++) { p.put(value); } \
+	for(uint64_t i = 0; i < iterations; i++) { \
+		if((i & 1023) == 0) { p.rewind(); } \
+		volatile T v = p.get(); (void)v; \
+	} \
+}
+
+BENCH_PUT(U8, put_U8, (uint8_t)i)
+BENCH_PUT(U16, put_U16, (uint16_t)i)
+BENCH_PUT(S16, put_S16, (int16_t)i)
+BENCH_PUT(U32, put_U32, (uint32_t)i)
+BENCH_PUT(S32, put_S32, (int32_t)i)
+BENCH_PUT(U64, put_U64, (uint64_t)i)
+BENCH_PUT(S64, put_S64, (int64_t)i)
+BENCH_PUT(String, put_String, "Das Erste HD")
+
+BENCH_GET(uint8_t, put_U8, get_U8, (uint8_t)i)
+BENCH_GET(uint16_t, put_U16, get_U16, (uint16_t)i)
+BENCH_GET(int16_t, put_S16, get_S16, (int16_t)i)
+BENCH_GET(uint32_t, put_U32, get_U32, (uint32_t)i)
+BENCH_GET(int32_t, put_S32, get_S32, (int32_t)i)
+BENCH_GET(uint64_t, put_U64, get_U64, (uint64_t)i)
+BENCH_GET(int64_t, put_S64, get_S64, (int64_t)i)
+
+static void bench_get_String(uint64_t iterations, uint32_t, void*) {
+	MsgPacket p;
+
+	for(int i = 0; i < 1024; i++) {
+		p.put_String("Das Erste HD");
+	}
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		if((i & 1023) == 0) {
+			p.rewind();
+		}
+
+		volatile const char* v = p.get_String();
+		(void)v;
+	}
+}
+
+// stream packet construction (as done by the live streamer)
+
+static void bench_put_Blob(uint64_t iterations, uint32_t size, void* arg) {
+	uint8_t* data = (uint8_t*)arg;
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		MsgPacket* p = new MsgPacket(4, 2);
+		p->put_U16(100);
+		p->put_S64(i);
+		p->put_S64(i);
+		p->put_U32(0);
+		p->put_U32(size);
+		p->put_Blob(data, size);
+		delete p;
+	}
+}
+
+static void bench_attach(uint64_t iterations, uint32_t size, void* arg) {
+	uint8_t* data = (uint8_t*)arg;
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		MsgPacket* p = new MsgPacket(4, 2);
+		p->put_U16(100);
+		p->put_S64(i);
+		p->put_S64(i);
+		p->put_U32(0);
+		p->put_U32(size);
+
+		MsgPayload* payload = MsgPayload::create(size);
+		memcpy(payload->data(), data, size);
+		p->attach(payload);
+		payload->unref();
+
+		delete p;
+	}
+}
+
+static void bench_get_Blob(uint64_t iterations, uint32_t size, void* arg) {
+	uint8_t* data = (uint8_t*)arg;
+	uint8_t* dest = (uint8_t*)malloc(size);
+	MsgPacket p;
+	p.put_Blob(data, size);
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		p.rewind();
+		p.get_Blob(dest, size);
+	}
+
+	free(dest);
+}
+
+// checksums
+
+static void bench_freeze(uint64_t iterations, uint32_t size, void* arg) {
+	MsgPayload* payload = MsgPayload::wrap((uint8_t*)arg, size);
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		MsgPacket p(1);
+		p.attach(payload);
+		p.freeze();
+	}
+
+	payload->unref();
+}
+
+static void bench_crc32(uint64_t iterations, uint32_t size, void* arg) {
+	uint8_t* data = (uint8_t*)arg;
+	volatile uint32_t crc = 0;
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		crc = crc ^ CRC32::checksum(data, size);
+	}
+}
+
+// compression
+
+struct CompressArg {
+	uint8_t* data;
+	int level;
+	int codec;
+};
+
+static void bench_compress(uint64_t iterations, uint32_t size, void* arg) {
+	CompressArg* a = (CompressArg*)arg;
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		MsgPacket p(1);
+		p.put_Blob(a->data, size);
+		p.compress(a->level, a->codec);
+	}
+}
+
+static void bench_uncompress(uint64_t iterations, uint32_t size, void* arg) {
+	CompressArg* a = (CompressArg*)arg;
+
+	MsgPacket c(1);
+	c.put_Blob(a->data, size);
+	c.compress(a->level, a->codec);
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		MsgPacket p(1);
+		p.put_Blob(c.getPayload(), c.getPayloadLength());
+
+		// restore the uncompressed length
+		uint32_t length = htobe32(size);
+		memcpy(p.getPacket() + MsgPacket::UncompressedPayloadLengthPos, &length, sizeof(length));
+
+		p.uncompress(a->codec);
+	}
+}
+
+// transport
+
+struct TransportArg {
+	int fd;
+	uint8_t* data;
+	uint32_t size;
+	uint64_t count;
+	bool batch;
+};
+
+static void* transport_writer(void* arg) {
+	TransportArg* a = (TransportArg*)arg;
+	MsgPacket* batch[16];
+	int n = 0;
+
+	for(uint64_t i = 0; i < a->count; i++) {
+		MsgPacket* p = new MsgPacket(4, 2);
+		p->disablePayloadCheckSum();
+		p->put_U32(a->size);
+
+		MsgPayload* payload = MsgPayload::wrap(a->data, a->size);
+		p->attach(payload);
+		payload->unref();
+
+		if(!a->batch) {
+			p->write(a->fd, 3000);
+			delete p;
+			continue;
+		}
+
+		batch[n++] = p;
+
+		if(n == 16 || i == a->count - 1) {
+			MsgPacket::write(a->fd, batch, n, 3000);
+
+			for(int j = 0; j < n; j++) {
+				delete batch[j];
+			}
+
+			n = 0;
+		}
+	}
+
+	return NULL;
+}
+
+static void transport(uint64_t iterations, uint32_t size, int fds[2], uint8_t* data, bool batch, bool buffered) {
+	TransportArg arg;
+	arg.fd = fds[0];
+	arg.data = data;
+	arg.size = size;
+	arg.count = iterations;
+	arg.batch = batch;
+
+	pthread_t thread;
+	pthread_create(&thread, NULL, transport_writer, &arg);
+
+	MsgReader reader(fds[1]);
+
+	for(uint64_t i = 0; i < iterations; i++) {
+		MsgPacket* p = buffered ? reader.read(3000) : MsgPacket::read(fds[1], 3000);
+
+		if(p == NULL) {
+			fprintf(stderr, "transport: read failed\n");
+			break;
+		}
+
+		delete p;
+	}
+
+	pthread_join(thread, NULL);
+}
+
+static bool socketpair_stream(int fds[2]) {
+	if(socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0) {
+		return false;
+	}
+
+	setsock_nonblock(fds[0]);
+	setsock_nonblock(fds[1]);
+	return true;
+}
+
+static bool loopback_tcp(int fds[2]) {
+	int server = socket(AF_INET, SOCK_STREAM, 0);
+	int one = 1;
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+
+	setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	socklen_t len = sizeof(addr);
+
+	if(bind(server, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(server, 1) != 0 || getsockname(server, (struct sockaddr*)&addr, &len) != 0) {
+		close(server);
+		return false;
+	}
+
+	fds[0] = socket(AF_INET, SOCK_STREAM, 0);
+
+	if(connect(fds[0], (struct sockaddr*)&addr, sizeof(addr)) != 0) {
+		close(server);
+		close(fds[0]);
+		return false;
+	}
+
+	fds[1] = accept(server, NULL, NULL);
+	close(server);
+
+	setsockopt(fds[0], IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+	setsock_nonblock(fds[0]);
+	setsock_nonblock(fds[1]);
+	return true;
+}
+
+struct TransportBench {
+	const char* name;
+	bool tcp;
+	bool batch;
+	bool buffered;
+};
+
+static void bench_transport(uint64_t iterations, uint32_t size, void* arg) {
+	TransportBench* b = (TransportBench*)arg;
+	int fds[2];
+	uint8_t* data = testdata(size, false);
+
+	if(b->tcp ? loopback_tcp(fds) : socketpair_stream(fds)) {
+		transport(iterations, size, fds, data, b->batch, b->buffered);
+		close(fds[0]);
+		close(fds[1]);
+	}
+
+	free(data);
+}
+
+static void usage() {
+	fprintf(stderr, "usage: msgbench [-t seconds] [-f filter] [-c crc32-engine]\n");
+	exit(1);
+}
+
+int main(int argc, char* argv[]) {
+	int c;
+
+	while((c = getopt(argc, argv, "t:f:c:h")) != -1) {
+		switch(c) {
+			case 't':
+				mintime = atof(optarg);
+				break;
+			case 'f':
+				filter = optarg;
+				break;
+			case 'c':
+				if(!CRC32::select(optarg)) {
+					fprintf(stderr, "crc32 engine '%s' not supported\n", optarg);
+					return 1;
+				}
+				break;
+			default:
+				usage();
+		}
+	}
+
+	srand(1);
+
+	fprintf(stderr, "crc32 engine: %s\n", CRC32::engine());
+	printf("name,size,iterations,ns_per_op,mb_per_s\n");
+
+	// put / get
+	run("put_U8", 1, bench_put_U8);
+	run("put_U16", 2, bench_put_U16);
+	run("put_S16", 2, bench_put_S16);
+	run("put_U32", 4, bench_put_U32);
+	run("put_S32", 4, bench_put_S32);
+	run("put_U64", 8, bench_put_U64);
+	run("put_S64", 8, bench_put_S64);
+	run("put_String", 13, bench_put_String);
+
+	run("get_U8", 1, bench_get_uint8_t);
+	run("get_U16", 2, bench_get_uint16_t);
+	run("get_S16", 2, bench_get_int16_t);
+	run("get_U32", 4, bench_get_uint32_t);
+	run("get_S32", 4, bench_get_int32_t);
+	run("get_U64", 8, bench_get_uint64_t);
+	run("get_S64", 8, bench_get_int64_t);
+	run("get_String", 13, bench_get_String);
+
+	uint8_t* data = testdata(blobsizes[blobcount - 1], false);
+
+	for(int i = 0; i < blobcount; i++) {
+		run("put_Blob", blobsizes[i], bench_put_Blob, data);
+	}
+
+	for(int i = 0; i < blobcount; i++) {
+		run("attach", blobsizes[i], bench_attach, data);
+	}
+
+	for(int i = 0; i < blobcount; i++) {
+		run("get_Blob", blobsizes[i], bench_get_Blob, data);
+	}
+
+	// checksums
+	for(int i = 0; i < blobcount; i++) {
+		run("freeze", blobsizes[i], bench_freeze, data);
+	}
+
+	const char* engines[] = { "table", "slice8", "pclmul", "armv8" };
+	const char* engine = CRC32::engine();
+
+	for(unsigned int e = 0; e < sizeof(engines) / sizeof(engines[0]); e++) {
+		if(!CRC32::select(engines[e])) {
+			continue;
+		}
+
+		char name[64];
+		snprintf(name, sizeof(name), "crc32_%s", engines[e]);
+
+		for(int i = 0; i < blobcount; i++) {
+			run(name, blobsizes[i], bench_crc32, data);
+		}
+	}
+
+	CRC32::select(engine);
+	free(data);
+
+	// compression
+	const uint32_t compresssize = 65536;
+	const char* codecs[] = { "zlib", "lz4" };
+
+	CompressArg carg;
+	carg.data = testdata(compresssize, true);
+
+	for(int codec = MsgPacket::CodecZlib; codec <= MsgPacket::CodecLZ4; codec++) {
+		if(!MsgPacket::codecSupported(codec)) {
+			continue;
+		}
+
+		for(int level = 1; level <= 9; level++) {
+			char name[64];
+			carg.level = level;
+			carg.codec = codec;
+
+			snprintf(name, sizeof(name), "compress_%s_%i", codecs[codec], level);
+			run(name, compresssize, bench_compress, &carg);
+
+			snprintf(name, sizeof(name), "uncompress_%s_%i", codecs[codec], level);
+			run(name, compresssize, bench_uncompress, &carg);
+		}
+	}
+
+	free(carg.data);
+
+	// transport
+	TransportBench transports[] = {
+		{ "socketpair_write_read", false, false, false },
+		{ "socketpair_write_reader", false, false, true },
+		{ "socketpair_batch_reader", false, true, true },
+		{ "tcp_write_read", true, false, false },
+		{ "tcp_write_reader", true, false, true },
+		{ "tcp_batch_reader", true, true, true }
+	};
+
+	const uint32_t transportsizes[] = { 188, 4096, 65536 };
+
+	for(unsigned int t = 0; t < sizeof(transports) / sizeof(transports[0]); t++) {
+		for(unsigned int i = 0; i < sizeof(transportsizes) / sizeof(transportsizes[0]); i++) {
+			run(transports[t].name, transportsizes[i], bench_transport, &transports[t]);
+		}
+	}
+
+	return 0;
+}